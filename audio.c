@@ -1,8 +1,46 @@
+#include <string.h>
 #include "audio.h"
+#include "clock.h"
 #include "config.h"
+#include "spiflash.h"
 #include <p32xxxx.h>
 
 unsigned int TMR_FREQ = 10000; // 10kHz
+unsigned int beepMs = 500; // length of the scan start beep
+
+audio_Note audioQueue[AUDIO_QUEUE_SIZE]; // written by the main loop, read by AUDIO_Tick
+volatile int audioHead = 0, audioTail = 0;
+volatile unsigned int audioRemaining = 0; // ms left of the note being played
+
+volatile unsigned char audioSonify = 0; // the output follows the measured colour
+volatile unsigned char audioSonifyPaused = 0; // sonification paused while the queued notes play
+volatile unsigned short audioNextPeriod, audioNextDuty; // PR3 and OC1RS loaded by AUDIO_PeriodEvent
+unsigned int audioToneFreq, audioToneDuty; // last AUDIO_SetTone, reapplied after a clock change
+
+const unsigned short audioPrescalers[8] = {1, 2, 4, 8, 16, 32, 64, 256}; // TCKPS -> divider
+
+const audio_Note patternRed[3] = {{2000, 80, 50}, {0, 40, 0}, {3000, 120, 50}};
+const audio_Note patternError[5] = {{400, 300, 50}, {0, 80, 0}, {400, 100, 50}, {0, 80, 0}, {400, 300, 50}};
+
+const unsigned short sonifyPeriods[AUDIO_SONIFY_STEPS] = {
+    AUDIO_PERIOD(220), AUDIO_PERIOD(233), AUDIO_PERIOD(247), AUDIO_PERIOD(262),
+    AUDIO_PERIOD(277), AUDIO_PERIOD(294), AUDIO_PERIOD(311), AUDIO_PERIOD(330),
+    AUDIO_PERIOD(349), AUDIO_PERIOD(370), AUDIO_PERIOD(392), AUDIO_PERIOD(415),
+    AUDIO_PERIOD(440), AUDIO_PERIOD(466), AUDIO_PERIOD(494), AUDIO_PERIOD(523),
+    AUDIO_PERIOD(554), AUDIO_PERIOD(587), AUDIO_PERIOD(622), AUDIO_PERIOD(659),
+    AUDIO_PERIOD(698), AUDIO_PERIOD(740), AUDIO_PERIOD(784), AUDIO_PERIOD(831)
+};
+
+volatile unsigned char audioPcm = audio_PCM_IDLE; // audio_PCM_x
+unsigned char audioPcmBuffer[AUDIO_PCM_BUFFER]; // ring played by the DMA (SPI flash clips)
+unsigned int audioPcmAddr, audioPcmLeft; // next flash address and samples still to be read
+volatile unsigned char audioPcmEmpty[2]; // half played, set by AUDIO_PcmEvent and cleared by the refill
+unsigned char audioPcmNextFill; // half that receives the next samples, the halves are refilled in turn
+volatile signed char audioPcmLast = -1; // half holding the end of the clip
+unsigned int audioPcmRate; // samples per second of the clip being played
+
+audio_PcmHeader audioUploadHeader; // written by AUDIO_PcmUploadData after the last sample
+unsigned int audioUploadHeaderAddr, audioUploadAddr, audioUploadLeft; // upload in progress if audioUploadLeft > 0
 
 /***	AUDIO_Init
 **
@@ -58,7 +96,7 @@ void AUDIO_InitPins() {
 */
 void AUDIO_ConfigureOC() {
     T3CONbits.TCKPS = 0;     //1:1 prescale value
-    PR3 = (PB_CLK / TMR_FREQ) * 1 - 1; // (PR+1) = (PBCLK / Freq_pwm) * Presc 
+    PR3 = (CLOCK_GetPB() / TMR_FREQ) * 1 - 1; // (PR+1) = (PBCLK / Freq_pwm) * Presc 
     TMR3 = 0; // initial TMR3 count is 0
    
     OC1CONbits.ON = 0; // Turn off OC1 while doing setup.
@@ -72,6 +110,25 @@ void AUDIO_ConfigureOC() {
     OC1CONbits.ON = 1; // turn on OC1
 }
 
+/***	AUDIO_SetBeep
+**
+**	Parameters:
+**      unsigned int freq - Beep frequency in Hz.
+**      unsigned int ms - Length of the scan start beep.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function sets the beep used by AUDIO_BeepStart and by the scan start pattern.
+**      
+**          
+*/
+void AUDIO_SetBeep(unsigned int freq, unsigned int ms) {
+    TMR_FREQ = freq;
+    beepMs = ms;
+}
+
 /***	AUDIO_BeepStart
 **
 **	Parameters:
@@ -81,12 +138,12 @@ void AUDIO_ConfigureOC() {
 **		
 **
 **	Description:
-**		This function starts the audio beep by setting the duty cycle of the OC1 module to 50%.
+**		This function starts the audio beep (TMR_FREQ) by setting the duty cycle of the OC1 module to 50%.
 **      
 **          
 */
 void AUDIO_BeepStart() {
-    OC1RS = (PR3 + 1) * 0.5; // duty-cycle 50%
+    AUDIO_SetTone(TMR_FREQ, 50); // duty-cycle 50%
 }
 
 /***	AUDIO_BeepStop
@@ -105,3 +162,752 @@ void AUDIO_BeepStart() {
 void AUDIO_BeepStop() {
     OC1RS = 0;
 }
+
+/***	AUDIO_PlayNote
+**
+**	Parameters:
+**      unsigned int freq - Frequency in Hz (0 for a rest).
+**      unsigned int ms - Duration in milliseconds.
+**      unsigned int duty - Duty cycle in percent (1..50, 50 is the loudest).
+**
+**	Return Value:
+**      int - 0 if queued, -1 if the queue is full.
+**
+**	Description:
+**		This function queues a note and returns at once: the notes are played one after
+**      the other by AUDIO_Tick, called by the 1 ms Timer2 interrupt.
+**      
+**          
+*/
+int AUDIO_PlayNote(unsigned int freq, unsigned int ms, unsigned int duty) {
+    audio_Note note = {freq, ms, duty};
+    return AUDIO_QueueNotes(&note, 1, 0);
+}
+
+/***	AUDIO_PlayPattern
+**
+**	Parameters:
+**      int pattern - audio_PATTERN_x.
+**
+**	Return Value:
+**
+**	Description:
+**		This function queues one of the feedback patterns as a whole: a pattern that does not fit
+**      in the queue is dropped, never truncated. The error pattern preempts the notes being played
+**      and a PCM clip, so it is heard at once even while a long beep or a clip is playing.
+**      During the sonification the patterns are played too, the sonification resumes after them.
+**      
+**          
+*/
+void AUDIO_PlayPattern(int pattern) {
+    audio_Note scan = {TMR_FREQ, beepMs, 50};
+    
+    switch (pattern) {
+        case audio_PATTERN_SCAN:
+            AUDIO_QueueNotes(&scan, 1, 0);
+            break;
+        case audio_PATTERN_RED:
+            AUDIO_QueueNotes(patternRed, 3, 0);
+            break;
+        case audio_PATTERN_ERROR:
+            AUDIO_QueueNotes(patternError, 5, 1);
+            break;
+    }
+}
+
+/***	AUDIO_QueueNotes
+**
+**	Parameters:
+**      const audio_Note *notes - Notes to be played in order.
+**      int count - Number of notes.
+**      int preempt - 1 to drop the notes playing and queued before and the PCM clip.
+**
+**	Return Value:
+**      int - 0 if queued, -1 if the queue has no room for all of them (none is queued)
+**            or a clip is playing and preempt is 0.
+**
+**	Description:
+**		This function appends notes to the queue with AUDIO_Tick masked (T2IE, cleared and set
+**      through IEC0CLR/IEC0SET), so the Timer2 interrupt never sees a pattern half queued.
+**      Queued notes pause the sonification: Timer3 is taken by the notes and AUDIO_Tick gives it
+**      back when the queue is empty.
+**      
+**          
+*/
+int AUDIO_QueueNotes(const audio_Note *notes, int count, int preempt) {
+    int err = 0;
+    
+    if (audioPcm) {
+        if (!preempt)
+            return -1;
+        AUDIO_PcmStop();
+    }
+    
+    IEC0CLR = _IEC0_T2IE_MASK;
+    
+    if (preempt) {
+        audioHead = audioTail;
+        audioRemaining = 0; // The first note starts at the next tick
+    }
+    
+    int used = (audioTail - audioHead + AUDIO_QUEUE_SIZE) % AUDIO_QUEUE_SIZE;
+    if (used + count > AUDIO_QUEUE_SIZE - 1) {
+        err = -1;
+    } else {
+        for (int i = 0; i < count; i++) {
+            audioQueue[audioTail] = notes[i];
+            audioTail = (audioTail + 1) % AUDIO_QUEUE_SIZE;
+        }
+        if (audioSonify) {
+            IEC0CLR = _IEC0_T3IE_MASK; // No period change under the notes
+            audioSonify = 0;
+            audioSonifyPaused = 1;
+        }
+    }
+    
+    IEC0SET = _IEC0_T2IE_MASK;
+    return err;
+}
+
+/***	AUDIO_Stop
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function clears the queue, ends the PCM playback and silences the output.
+**      A sonification paused by the notes resumes.
+**      
+**          
+*/
+void AUDIO_Stop() {
+    AUDIO_PcmStop();
+    IEC0CLR = _IEC0_T2IE_MASK; // AUDIO_Tick is not called while the queue is changed
+    audioHead = audioTail;
+    audioRemaining = 0;
+    OC1RS = 0;
+    if (audioSonifyPaused)
+        AUDIO_SonifyResume();
+    IEC0SET = _IEC0_T2IE_MASK;
+}
+
+/***	AUDIO_IsPlaying
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - 1 while a note is playing or queued, or a clip is playing.
+**
+**	Description:
+**		This function checks the sequencer and PCM state.
+**      
+**          
+*/
+int AUDIO_IsPlaying() {
+    return audioRemaining > 0 || audioHead != audioTail || audioPcm;
+}
+
+/***	AUDIO_Tick
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function has to be called every millisecond (Timer2 interrupt). When the current
+**      note ends it programs the next one, or silences the output if the queue is empty and
+**      resumes the sonification paused by the notes.
+**      
+**          
+*/
+void AUDIO_Tick() {
+    if (audioRemaining > 0) {
+        if (--audioRemaining > 0)
+            return;
+        if (audioHead == audioTail) {
+            OC1RS = 0; // Last note ended
+            if (audioSonifyPaused)
+                AUDIO_SonifyResume(); // Silent until the next AUDIO_Sonify
+            return;
+        }
+    } else if (audioHead == audioTail) {
+        return; // Idle (AUDIO_BeepStart is left alone)
+    }
+    
+    audio_Note *note = &audioQueue[audioHead];
+    AUDIO_SetTone(note->freq, note->duty);
+    audioRemaining = note->ms ? note->ms : 1;
+    audioHead = (audioHead + 1) % AUDIO_QUEUE_SIZE;
+}
+
+/***	AUDIO_SonifyStart
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function starts the sonification mode: the queued notes are dropped and the
+**      output follows AUDIO_Sonify. Timer3 runs at AUDIO_SONIFY_CLOCK for the whole mode, apart
+**      from the notes that pause it.
+**      
+**          
+*/
+void AUDIO_SonifyStart() {
+    AUDIO_Stop();
+    IPC3bits.T3IP = AUDIO_INT_PRIORITY;
+    IPC3bits.T3IS = 0;
+    AUDIO_SonifyResume();
+}
+
+/***	AUDIO_SonifyResume
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function gives Timer3 back to the sonification, at the start or after the notes
+**      that paused it. PR3 is left as it is, so the duty cycle in effect still fits the period,
+**      and is changed by AUDIO_PeriodEvent with the next sample.
+**      
+**          
+*/
+void AUDIO_SonifyResume() {
+    audioSonifyPaused = 0;
+    audioSonify = 1;
+    
+    T3CONbits.ON = 0;
+    T3CONbits.TCKPS = AUDIO_SonifyPrescaler();
+    TMR3 = 0;
+    T3CONbits.ON = 1;
+    IFS0CLR = _IFS0_T3IF_MASK;
+}
+
+/***	AUDIO_SonifyStop
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function ends the sonification mode and silences the output.
+**      
+**          
+*/
+void AUDIO_SonifyStop() {
+    IEC0CLR = _IEC0_T3IE_MASK;
+    audioSonify = 0;
+    audioSonifyPaused = 0;
+    OC1RS = 0;
+}
+
+/***	AUDIO_Sonify
+**
+**	Parameters:
+**      unsigned int r, g, b - Colour channels (any scale).
+**      unsigned int c - Clear channel count.
+**
+**	Return Value:
+**
+**	Description:
+**		This function maps a sample to the output: the hue selects the pitch from a table of
+**      periods, the clear level (in bits) selects the duty cycle as a shift of the period.
+**      No division is done: the pair is loaded by AUDIO_PeriodEvent at the next period boundaries,
+**      so the waveform never has a truncated or stretched period and the duty cycle in effect
+**      never exceeds the period.
+**      
+**          
+*/
+void AUDIO_Sonify(unsigned int r, unsigned int g, unsigned int b, unsigned int c) {
+    if (!audioSonify)
+        return;
+    
+    int step = AUDIO_HueStep(r, g, b);
+    if (step < 0 || c == 0) {
+        IEC0CLR = _IEC0_T3IE_MASK; // A pending period change would restore the old duty cycle
+        OC1RS = 0; // Grey or dark: silence
+        return;
+    }
+    
+    int bits = 32 - __builtin_clz(c); // 1..32
+    int shift = bits >= 16 ? 1 : 1 + (16 - bits) / 2; // 50% at full scale, halved every 2 bits
+    if (shift > 7)
+        shift = 7;
+    
+    unsigned short period = sonifyPeriods[step];
+    IEC0CLR = _IEC0_T3IE_MASK; // The pair is not read while it is written
+    audioNextPeriod = period;
+    audioNextDuty = period >> shift;
+    IFS0CLR = _IFS0_T3IF_MASK; // A flag left by an earlier boundary would call it in mid period
+    IEC0SET = _IEC0_T3IE_MASK; // AUDIO_PeriodEvent at the next boundary
+}
+
+/***	AUDIO_PeriodEvent
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function is called by the Timer3 interrupt, just after the end of a period.
+**      PR3 applies to the period just started, while OC1RS reaches OC1R only at the next boundary:
+**      PR3 is changed only when the duty cycle in effect (OC1R) fits in the new period, otherwise
+**      the output would stay high for a whole period. A longer period is loaded at once with the
+**      new duty cycle; for a shorter one the duty cycle goes first and PR3 follows at the next
+**      boundary. The interrupt is disabled once both are loaded, until the next change.
+**      
+**          
+*/
+void AUDIO_PeriodEvent() {
+    OC1RS = audioNextDuty; // Always shorter than audioNextPeriod
+    if (OC1R <= audioNextPeriod) {
+        PR3 = audioNextPeriod;
+        IEC0CLR = _IEC0_T3IE_MASK;
+    }
+}
+
+/***	AUDIO_HueStep
+**
+**	Parameters:
+**      unsigned int r, g, b - Colour channels.
+**
+**	Return Value:
+**      int - Hue in steps of 15 degrees (0..AUDIO_SONIFY_STEPS - 1), -1 for a grey.
+**
+**	Description:
+**		This function finds the hue sector (60 degrees) from the order of the channels and
+**      the position inside it by comparing 4 * (mid - min) with multiples of (max - min).
+**      
+**          
+*/
+int AUDIO_HueStep(unsigned int r, unsigned int g, unsigned int b) {
+    unsigned int max, mid, min;
+    int sector, rising;
+    
+    if (r >= g && r >= b) {
+        max = r;
+        rising = g >= b; // red -> yellow (0) or magenta -> red (5)
+        sector = rising ? 0 : 5;
+        mid = rising ? g : b;
+        min = rising ? b : g;
+    } else if (g >= b) {
+        max = g;
+        rising = b >= r; // green -> cyan (2) or yellow -> green (1)
+        sector = rising ? 2 : 1;
+        mid = rising ? b : r;
+        min = rising ? r : b;
+    } else {
+        max = b;
+        rising = r >= g; // blue -> magenta (4) or cyan -> blue (3)
+        sector = rising ? 4 : 3;
+        mid = rising ? r : g;
+        min = rising ? g : r;
+    }
+    
+    if (max == min)
+        return -1;
+    
+    int step = 0;
+    for (int k = 1; k < 4; k++) {
+        if (4 * (mid - min) >= k * (max - min))
+            step = k;
+    }
+    return sector * 4 + (rising ? step : 3 - step);
+}
+
+/***	AUDIO_SonifyPrescaler
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - Timer3 TCKPS value.
+**
+**	Description:
+**		This function returns the prescaler that brings the current peripheral bus clock down to
+**      AUDIO_SONIFY_CLOCK, the clock the sonifyPeriods table is computed for.
+**      
+**          
+*/
+int AUDIO_SonifyPrescaler() {
+    int tckps = 0;
+    
+    while (tckps < 7 && CLOCK_GetPB() / audioPrescalers[tckps] > AUDIO_SONIFY_CLOCK)
+        tckps++;
+    return tckps;
+}
+
+/***	AUDIO_ClockChanged
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function reapplies the timer settings of the running sound after a peripheral bus clock
+**      change: the sample rate of a PCM clip, the sonification prescaler or the note being played.
+**      The PCM carrier (PR3 = 255) follows the clock, 39 kHz at 10 MHz is still above the audio band.
+**      
+**          
+*/
+void AUDIO_ClockChanged() {
+    if (audioPcm != audio_PCM_IDLE) {
+        PR4 = CLOCK_GetPB() / audioPcmRate - 1;
+        TMR4 = 0;
+    } else if (audioSonify) {
+        T3CONbits.TCKPS = AUDIO_SonifyPrescaler();
+    } else if (OC1RS) {
+        AUDIO_SetTone(audioToneFreq, audioToneDuty);
+    }
+}
+
+/***	AUDIO_SetTone
+**
+**	Parameters:
+**      unsigned int freq - Frequency in Hz (0 for silence).
+**      unsigned int duty - Duty cycle in percent.
+**
+**	Return Value:
+**
+**	Description:
+**		This function reprograms Timer3 and OC1 for a note. The smallest prescaler that keeps
+**      PR3 in 16 bits is used, so the pitch is as accurate as possible.
+**      
+**          
+*/
+void AUDIO_SetTone(unsigned int freq, unsigned int duty) {
+    unsigned int pb = CLOCK_GetPB();
+    unsigned int period;
+    int tckps = 0;
+    
+    audioToneFreq = freq;
+    audioToneDuty = duty;
+    if (freq < AUDIO_MIN_FREQ || duty == 0) {
+        OC1RS = 0;
+        return;
+    }
+    
+    while ((period = pb / (audioPrescalers[tckps] * freq)) > 0x10000 && tckps < 7)
+        tckps++;
+    
+    T3CONbits.ON = 0;
+    T3CONbits.TCKPS = tckps;
+    PR3 = period - 1;
+    TMR3 = 0;
+    OC1RS = period * duty / 100;
+    T3CONbits.ON = 1;
+}
+
+/***	AUDIO_PcmPlay
+**
+**	Parameters:
+**      const unsigned char *samples - 8 bit unsigned samples in program memory.
+**      unsigned int length - Number of samples (1..AUDIO_PCM_MAX_LENGTH).
+**      unsigned int rate - Samples per second (AUDIO_PCM_MIN_RATE..AUDIO_PCM_MAX_RATE).
+**
+**	Return Value:
+**      int - 0 if started, -1 if the clip is not valid.
+**
+**	Description:
+**		This function plays a clip from program memory and returns at once. The DMA reads the
+**      samples straight from flash as a single block, so the CPU is not involved until the end.
+**      
+**          
+*/
+int AUDIO_PcmPlay(const unsigned char *samples, unsigned int length, unsigned int rate) {
+    if (length == 0 || length > AUDIO_PCM_MAX_LENGTH || rate < AUDIO_PCM_MIN_RATE || rate > AUDIO_PCM_MAX_RATE)
+        return -1;
+    
+    AUDIO_PcmStart(KVA_TO_PA(samples), length, rate, audio_PCM_MEMORY);
+    return 0;
+}
+
+/***	AUDIO_PcmPlayFlash
+**
+**	Parameters:
+**      unsigned int addr - Address of the clip header (audio_PcmHeader) in SPI flash.
+**      unsigned int end - End of the clip area.
+**
+**	Return Value:
+**      int - 0 if started, -1 if no valid clip is stored at addr.
+**
+**	Description:
+**		This function plays a clip from SPI flash: the ring is filled with the first samples
+**      and AUDIO_PcmProcess reads the rest from the main loop, one half at a time.
+**      
+**          
+*/
+int AUDIO_PcmPlayFlash(unsigned int addr, unsigned int end) {
+    audio_PcmHeader header;
+    
+    SPIFLASH_Read(addr, (unsigned char *) &header, sizeof(header));
+    if (header.magic != audio_PCM_MAGIC || header.length == 0 || header.length > end - addr - sizeof(header) ||
+            header.rate < AUDIO_PCM_MIN_RATE || header.rate > AUDIO_PCM_MAX_RATE)
+        return -1;
+    
+    AUDIO_Stop();
+    audioPcmAddr = addr + sizeof(header);
+    audioPcmLeft = header.length;
+    audioPcmLast = -1;
+    AUDIO_PcmFill(0);
+    AUDIO_PcmFill(1);
+    audioPcmNextFill = 0;
+    AUDIO_PcmStart(KVA_TO_PA(audioPcmBuffer), AUDIO_PCM_BUFFER, header.rate, audio_PCM_FLASH);
+    return 0;
+}
+
+/***	AUDIO_PcmStart
+**
+**	Parameters:
+**      unsigned int src - Physical address of the samples.
+**      unsigned int size - Number of samples of the DMA block.
+**      unsigned int rate - Samples per second.
+**      int mode - audio_PCM_MEMORY (one block) or audio_PCM_FLASH (ring).
+**
+**	Return Value:
+**
+**	Description:
+**		This function stops any other sound, sets Timer3 to the 8 bit carrier, Timer4 to the sample
+**      rate and DMA channel 0 to move one byte into OC1RS at every Timer4 event. In ring mode the
+**      channel is enabled again at the end of the block and interrupts at each half.
+**      
+**          
+*/
+void AUDIO_PcmStart(unsigned int src, unsigned int size, unsigned int rate, int mode) {
+    AUDIO_Stop();
+    AUDIO_SonifyStop();
+    
+    T3CONbits.ON = 0;
+    T3CONbits.TCKPS = 0;
+    PR3 = AUDIO_PCM_PR3;
+    TMR3 = 0;
+    OC1RS = AUDIO_PCM_SILENCE; // The DMA writes the low byte only
+    T3CONbits.ON = 1;
+    
+    T4CON = 0; // 1:1 prescale value
+    audioPcmRate = rate;
+    PR4 = CLOCK_GetPB() / rate - 1;
+    TMR4 = 0;
+    
+    DMACONbits.ON = 1;
+    DCH0CON = 0;
+    DCH0ECON = 0;
+    DCH0INT = 0;
+    DCH0SSA = src;
+    DCH0DSA = KVA_TO_PA(&OC1RS);
+    DCH0SSIZ = size;
+    DCH0DSIZ = 1;
+    DCH0CSIZ = 1; // One sample per trigger
+    DCH0ECONbits.CHSIRQ = _TIMER_4_IRQ;
+    DCH0ECONbits.SIRQEN = 1;
+    DCH0CONbits.CHPRI = 3;
+    DCH0CONbits.CHAEN = mode == audio_PCM_FLASH;
+    DCH0INTbits.CHBCIE = 1;
+    DCH0INTbits.CHSHIE = mode == audio_PCM_FLASH;
+    
+    IPC9bits.DMA0IP = AUDIO_DMA_PRIORITY;
+    IPC9bits.DMA0IS = 0;
+    IFS1CLR = _IFS1_DMA0IF_MASK;
+    IEC1SET = _IEC1_DMA0IE_MASK;
+    
+    audioPcmEmpty[0] = audioPcmEmpty[1] = 0;
+    audioPcm = mode;
+    DCH0CONbits.CHEN = 1;
+    T4CONbits.ON = 1;
+}
+
+/***	AUDIO_PcmStop
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function ends the PCM playback and silences the output. It is also called by
+**      AUDIO_PcmEvent at the end of a clip.
+**      
+**          
+*/
+void AUDIO_PcmStop() {
+    if (!audioPcm)
+        return;
+    
+    T4CONbits.ON = 0;
+    IEC1CLR = _IEC1_DMA0IE_MASK;
+    DCH0CONbits.CHEN = 0;
+    OC1RS = 0;
+    audioPcm = audio_PCM_IDLE;
+}
+
+/***	AUDIO_PcmProcess
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function has to be called by the main loop: it refills from SPI flash the halves of
+**      the ring already played. Each half lasts AUDIO_PCM_HALF samples (64 ms at 8 kHz), the main
+**      loop must come back within that time or the old samples are played again.
+**      The halves are refilled in turn, in the order they are played, so the samples read from the
+**      flash stay in sequence even when both halves were played before the main loop came back.
+**      
+**          
+*/
+void AUDIO_PcmProcess() {
+    while (audioPcm == audio_PCM_FLASH && audioPcmEmpty[audioPcmNextFill]) {
+        audioPcmEmpty[audioPcmNextFill] = 0;
+        AUDIO_PcmFill(audioPcmNextFill);
+        audioPcmNextFill ^= 1;
+    }
+}
+
+/***	AUDIO_PcmFill
+**
+**	Parameters:
+**      int half - Half of the ring (0 or 1).
+**
+**	Return Value:
+**
+**	Description:
+**		This function reads the next samples of the clip into a half of the ring and pads it
+**      with silence after the end, marking the half where the clip ends.
+**      
+**          
+*/
+void AUDIO_PcmFill(int half) {
+    unsigned char *buf = audioPcmBuffer + half * AUDIO_PCM_HALF;
+    unsigned int n = audioPcmLeft < AUDIO_PCM_HALF ? audioPcmLeft : AUDIO_PCM_HALF;
+    
+    if (n) {
+        SPIFLASH_Read(audioPcmAddr, buf, n);
+        audioPcmAddr += n;
+        audioPcmLeft -= n;
+        if (audioPcmLeft == 0)
+            audioPcmLast = half;
+    }
+    memset(buf + n, AUDIO_PCM_SILENCE, AUDIO_PCM_HALF - n);
+}
+
+/***	AUDIO_PcmEvent
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function is called by the DMA channel 0 interrupt when the source pointer passes the
+**      middle (first half played) or the end of the block (second half played, or the whole
+**      program memory clip). The playback stops after the half holding the end of the clip.
+**      When the interrupt was served late and both flags are set, both halves are handled in the
+**      order they were played: the half the DMA is reading now is the one that ended first.
+**      
+**          
+*/
+void AUDIO_PcmEvent() {
+    int halfDone = DCH0INTbits.CHSHIF, blockDone = DCH0INTbits.CHBCIF;
+    int halves[2], count = 0;
+    
+    DCH0INTCLR = _DCH0INT_CHSHIF_MASK | _DCH0INT_CHBCIF_MASK;
+    
+    if (audioPcm == audio_PCM_MEMORY) {
+        if (blockDone)
+            AUDIO_PcmStop();
+        return;
+    }
+    
+    if (halfDone && blockDone) {
+        halves[0] = DCH0SPTR >= AUDIO_PCM_HALF; // Reading the second half: it ended before the first one
+        halves[1] = !halves[0];
+        count = 2;
+    } else if (halfDone || blockDone) {
+        halves[0] = blockDone;
+        count = 1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (halves[i] == audioPcmLast) {
+            AUDIO_PcmStop();
+            return;
+        }
+        audioPcmEmpty[halves[i]] = 1;
+    }
+}
+
+/***	AUDIO_PcmUploadStart
+**
+**	Parameters:
+**      unsigned int addr - Address of the clip header in SPI flash.
+**      unsigned int end - End of the clip area.
+**      unsigned int rate - Samples per second (AUDIO_PCM_MIN_RATE..AUDIO_PCM_MAX_RATE).
+**      unsigned int length - Number of samples.
+**
+**	Return Value:
+**      int - 0 if the area is erased and ready, -1 if the clip is not valid or does not fit.
+**
+**	Description:
+**		This function starts storing a clip for AUDIO_PcmPlayFlash: the sectors needed are erased
+**      (about 50 ms each) and the samples are then passed to AUDIO_PcmUploadData as they arrive.
+**      The header is written after the last sample, so an interrupted upload is never played.
+**      
+**          
+*/
+int AUDIO_PcmUploadStart(unsigned int addr, unsigned int end, unsigned int rate, unsigned int length) {
+    if (length == 0 || length > end - addr - sizeof(audio_PcmHeader) || rate < AUDIO_PCM_MIN_RATE || rate > AUDIO_PCM_MAX_RATE)
+        return -1;
+    
+    AUDIO_PcmStop(); // The ring may be reading the area
+    for (unsigned int sector = addr; sector < addr + sizeof(audio_PcmHeader) + length; sector += SPIFLASH_SECTOR_SIZE)
+        SPIFLASH_EraseSector(sector);
+    
+    audioUploadHeader.magic = audio_PCM_MAGIC;
+    audioUploadHeader.rate = rate;
+    audioUploadHeader.length = length;
+    audioUploadHeaderAddr = addr;
+    audioUploadAddr = addr + sizeof(audio_PcmHeader);
+    audioUploadLeft = length;
+    return 0;
+}
+
+/***	AUDIO_PcmUploadData
+**
+**	Parameters:
+**      unsigned char *samples - Next samples of the clip.
+**      unsigned int len - Number of samples.
+**
+**	Return Value:
+**      int - Samples still expected (0 when the clip is complete), -1 if the upload failed
+**      (too many samples or flash error), the upload is then cancelled.
+**
+**	Description:
+**		This function programs the samples received, split at the flash page boundaries,
+**      and writes the header once the last one has been stored.
+**      
+**          
+*/
+int AUDIO_PcmUploadData(unsigned char *samples, unsigned int len) {
+    if (len > audioUploadLeft) {
+        audioUploadLeft = 0;
+        return -1;
+    }
+    
+    while (len) {
+        unsigned int n = SPIFLASH_PAGE_SIZE - (audioUploadAddr & (SPIFLASH_PAGE_SIZE - 1));
+        if (n > len)
+            n = len;
+        if (SPIFLASH_ProgramVerify(audioUploadAddr, samples, n)) {
+            audioUploadLeft = 0;
+            return -1;
+        }
+        audioUploadAddr += n;
+        audioUploadLeft -= n;
+        samples += n;
+        len -= n;
+    }
+    
+    if (audioUploadLeft == 0 &&
+            SPIFLASH_ProgramVerify(audioUploadHeaderAddr, (unsigned char *) &audioUploadHeader, sizeof(audio_PcmHeader)))
+        return -1;
+    return audioUploadLeft;
+}
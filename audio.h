@@ -15,16 +15,88 @@
 #define lat_AUDIO_PWM LATBbits.LATB14
 #define ansel_AUDIO_PWM ANSELBbits.ANSB14
 #define rp_AUDIO_PWM RPB14R
-#define vector_TIMER3 12
+
+/* tone sequencer */
+#define AUDIO_QUEUE_SIZE 16 // notes waiting to be played
+#define AUDIO_MIN_FREQ 20 // Hz, SYS_CLK / 256 / 65536 = 4.8 Hz
+
+#define audio_PATTERN_SCAN 0 // scan start: the beep of the settings
+#define audio_PATTERN_RED 1 // red detected: two short rising notes
+#define audio_PATTERN_ERROR 2 // error: low long-short-long
+
+/* sonification: hue -> pitch (2 octaves from 220 Hz, one semitone every 15 degrees), clear -> duty */
+#define AUDIO_INT_PRIORITY 3 // Timer3 period interrupt, used only to load a new period
+#define AUDIO_SONIFY_CLOCK (SYS_CLK / 16) // Timer3 clock, reached by a prescaler in every clock profile
+#define AUDIO_SONIFY_STEPS 24 // 6 hue sectors x 4
+#define AUDIO_PERIOD(f) (AUDIO_SONIFY_CLOCK / (f) - 1)
+
+/*
+ * PCM playback: Timer3 runs at PB_CLK with PR3 = 255 (8 bit PWM, 156 kHz carrier at 40 MHz, far above the audio band),
+ * Timer4 paces the samples and its interrupt event starts a DMA channel 0 cell transfer of one sample into
+ * the low byte of OC1RS. Clips in program memory are one DMA block; clips in SPI flash go through a RAM ring
+ * that the DMA plays in a loop while AUDIO_PcmProcess refills the half just played.
+ */
+#define AUDIO_PCM_PR3 255
+#define AUDIO_PCM_SILENCE 0x80 // 8 bit unsigned samples
+#define AUDIO_PCM_BUFFER 1024 // ring for the SPI flash clips: 64 ms at 8 kHz per half
+#define AUDIO_PCM_HALF (AUDIO_PCM_BUFFER / 2)
+#define AUDIO_PCM_MIN_RATE (SYS_CLK / 65536 + 1) // Hz, PR4 in 16 bits at the fastest clock profile
+#define AUDIO_PCM_MAX_RATE 22050
+#define AUDIO_PCM_MAX_LENGTH 65535 // DMA source size of a program memory clip
+#define AUDIO_DMA_PRIORITY 2 // DMA channel 0 interrupt (half and block done)
+#define AUDIO_PCM_UPLOAD_LINE 32 // samples per hex line of the clip upload (tools/pcmupload.c)
+
+#define audio_PCM_IDLE 0
+#define audio_PCM_MEMORY 1 // one block from program memory
+#define audio_PCM_FLASH 2 // ring refilled from SPI flash
+
+/* clip in SPI flash: header followed by length samples */
+#define audio_PCM_MAGIC 0x4D43 // "CM"
+typedef struct {
+    unsigned short magic;
+    unsigned short rate; // samples per second
+    unsigned int length; // number of samples
+} audio_PcmHeader;
+
+typedef struct {
+    unsigned short freq; // Hz, 0 for a rest
+    unsigned short ms; // duration
+    unsigned char duty; // duty cycle in percent (volume)
+} audio_Note;
 
 /* public functions */
 void AUDIO_Init();
+void AUDIO_SetBeep(unsigned int freq, unsigned int ms);
 void AUDIO_BeepStart();
 void AUDIO_BeepStop();
+int AUDIO_PlayNote(unsigned int freq, unsigned int ms, unsigned int duty);
+void AUDIO_PlayPattern(int pattern);
+void AUDIO_Stop();
+int AUDIO_IsPlaying();
+void AUDIO_Tick();
+void AUDIO_SonifyStart();
+void AUDIO_SonifyStop();
+void AUDIO_Sonify(unsigned int r, unsigned int g, unsigned int b, unsigned int c);
+void AUDIO_PeriodEvent();
+int AUDIO_PcmPlay(const unsigned char *samples, unsigned int length, unsigned int rate);
+int AUDIO_PcmPlayFlash(unsigned int addr, unsigned int end);
+void AUDIO_PcmStop();
+void AUDIO_PcmProcess();
+void AUDIO_PcmEvent();
+int AUDIO_PcmUploadStart(unsigned int addr, unsigned int end, unsigned int rate, unsigned int length);
+int AUDIO_PcmUploadData(unsigned char *samples, unsigned int len);
+void AUDIO_ClockChanged();
 
 /* private functions */
+int AUDIO_QueueNotes(const audio_Note *notes, int count, int preempt);
 void AUDIO_InitPins();
 void AUDIO_ConfigureOC();
+void AUDIO_SetTone(unsigned int freq, unsigned int duty);
+void AUDIO_SonifyResume();
+int AUDIO_SonifyPrescaler();
+int AUDIO_HueStep(unsigned int r, unsigned int g, unsigned int b);
+void AUDIO_PcmStart(unsigned int src, unsigned int size, unsigned int rate, int mode);
+void AUDIO_PcmFill(int half);
 
 #endif	/* AUDIO_H */
 
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include "boot.h"
+#include "timer.h"
+#include "uart.h"
+
+boot_Task bootTasks[BOOT_MAX_TASKS];
+int bootCount = 0;
+unsigned int bootStart = 0; // core timer at BOOT_Start (0: since reset)
+
+/***	BOOT_Start
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function sets the start of the boot, the reference of all the task deadlines and times.
+**      It is the first call of main.
+**      
+**          
+*/
+void BOOT_Start() {
+    bootStart = TIMER_GetCoreTicks();
+    bootCount = 0;
+}
+
+/***	BOOT_Add
+**
+**	Parameters:
+**      const char *name - Task name, shown by BOOT_Report.
+**      boot_Step step - Step function of the task.
+**
+**	Return Value:
+**      int - Task handle for BOOT_Wait and BOOT_IsDone, -1 if the table is full.
+**
+**	Description:
+**		This function adds a task and runs its first step at once, so the power-up of the
+**      peripheral starts immediately.
+**      
+**          
+*/
+int BOOT_Add(const char *name, boot_Step step) {
+    if (bootCount >= BOOT_MAX_TASKS)
+        return -1;
+    
+    boot_Task *task = &bootTasks[bootCount];
+    task->name = name;
+    task->step = step;
+    task->next = 0;
+    BOOT_RunStep(task);
+    return bootCount++;
+}
+
+/***	BOOT_Process
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**      int - Number of tasks still running.
+**
+**	Description:
+**		This function runs the steps whose wait is over. It is called by BOOT_Wait and by the main
+**      loop, for the tasks that do not have to end before it starts.
+**      
+**          
+*/
+int BOOT_Process() {
+    int running = 0;
+    
+    for (int i = 0; i < bootCount; i++) {
+        boot_Task *task = &bootTasks[i];
+        
+        if (task->next >= 0 && (int) (TIMER_GetCoreTicks() - task->due) >= 0)
+            BOOT_RunStep(task);
+        if (task->next >= 0)
+            running++;
+    }
+    return running;
+}
+
+/***	BOOT_Wait
+**
+**	Parameters:
+**      int task - Task handle returned by BOOT_Add.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function runs all the tasks until the given one has ended.
+**      
+**          
+*/
+void BOOT_Wait(int task) {
+    while (!BOOT_IsDone(task))
+        BOOT_Process();
+}
+
+/***	BOOT_IsDone
+**
+**	Parameters:
+**      int task - Task handle returned by BOOT_Add.
+**
+**	Return Value:
+**      int - 1 if the task has ended (or the handle is not valid), 0 otherwise.
+**
+**	Description:
+**		This function tells whether a task has ended.
+**      
+**          
+*/
+int BOOT_IsDone(int task) {
+    return task < 0 || task >= bootCount || bootTasks[task].next < 0;
+}
+
+/***	BOOT_GetTime
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**      unsigned int - Microseconds from BOOT_Start.
+**
+**	Description:
+**		This function returns the boot clock, shared by all the tasks: a power-up delay counted
+**      from the start of the boot is over as soon as the step is reached.
+**      
+**          
+*/
+unsigned int BOOT_GetTime() {
+    return (TIMER_GetCoreTicks() - bootStart) / CORE_TICKS_PER_US;
+}
+
+/***	BOOT_Report
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function prints the time at which each task has ended, in ms from the start of main.
+**      
+**          
+*/
+void BOOT_Report() {
+    char uartPrint[60];
+    
+    UART_PutString("Avvio:");
+    for (int i = 0; i < bootCount; i++) {
+        boot_Task *task = &bootTasks[i];
+        
+        if (task->next >= 0)
+            snprintf(uartPrint, sizeof(uartPrint), " %s in corso", task->name);
+        else
+            snprintf(uartPrint, sizeof(uartPrint), " %s %u.%u ms%s", task->name, task->time / 1000,
+                    task->time % 1000 / 100, task->result == boot_FAILED ? " (errore)" : "");
+        UART_PutString(uartPrint);
+        UART_PutString(i < bootCount - 1 ? "," : "\n");
+    }
+}
+
+/***	BOOT_RunStep
+**
+**	Parameters:
+**      boot_Task *task - Task.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function runs the next step of a task and schedules the following one.
+**      
+**          
+*/
+void BOOT_RunStep(boot_Task *task) {
+    int wait = task->step(task->next);
+    
+    if (wait < 0) {
+        task->next = -1;
+        task->time = BOOT_GetTime();
+        task->result = wait;
+    } else {
+        task->next++;
+        task->due = TIMER_GetCoreTicks() + wait * CORE_TICKS_PER_US;
+    }
+}
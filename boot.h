@@ -0,0 +1,51 @@
+/*
+ * File:   boot.h
+ * @brief Header file for the boot sequencer.
+ *
+ * This file contains the definitions and function prototypes for initializing the slow peripherals
+ * concurrently and measuring the boot times.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef BOOT_H
+#define	BOOT_H
+
+#include "config.h"
+
+/*
+ * A boot task is a step function: boot_Step(step) performs the step number step (0 first) and returns
+ * the minimum wait in microseconds before the next step, or boot_DONE / boot_FAILED when the task ends.
+ * BOOT_Add starts a task at once, BOOT_Process runs the steps whose wait is over, so the power-up delays
+ * of the peripherals overlap with each other and with the rest of the initialization. All the times
+ * are measured on the core timer from BOOT_Start.
+ */
+#define BOOT_MAX_TASKS 4
+
+#define boot_DONE -1
+#define boot_FAILED -2
+
+typedef int (*boot_Step)(int step);
+
+typedef struct {
+    const char *name; // shown by BOOT_Report
+    boot_Step step;
+    int next; // next step, -1 when the task has ended
+    unsigned int due; // core timer tick of the next step
+    unsigned int time; // us from BOOT_Start when the task ended
+    int result; // boot_DONE or boot_FAILED
+} boot_Task;
+
+/* public functions */
+void BOOT_Start();
+int BOOT_Add(const char *name, boot_Step step);
+int BOOT_Process();
+void BOOT_Wait(int task);
+int BOOT_IsDone(int task);
+unsigned int BOOT_GetTime();
+void BOOT_Report();
+
+/* private functions */
+void BOOT_RunStep(boot_Task *task);
+
+#endif	/* BOOT_H */
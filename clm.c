@@ -1,73 +1,552 @@
+#include <stddef.h>
+#include <string.h>
+#include "boot.h"
 #include "clm.h"
+#include "config.h"
 #include "i2c.h"
+#include "settings.h"
+#include "spiflash.h"
 #include "timer.h"
 
-int iTime = 0;
+const unsigned char clm_GainFactor[4] = {1, 4, 16, 60}; // AGAIN -> gain
 
-/***	CLM_Init
+clm_Sensor sensors[clm_MAX_SENSORS];
+int sensorCount = 0;
+unsigned int clmStartTime; // BOOT_GetTime when CLM_InitStep enabled the integration (AEN)
+int clmInitError; // first I2C error of CLM_InitStep
+unsigned char muxCurrent = clm_MUX_NONE; // Channel currently selected on the TCA9548A
+int clmCalCopy = 1; // calibration copy holding the active values
+unsigned int clmCalSequence = 0;
+
+// HDR exposures, ordered from the strongest to the weakest
+clm_Exposure hdrExposures[clm_HDR_MAX];
+unsigned int hdrRatio[clm_HDR_MAX]; // Q16 scale of each exposure to the strongest one
+unsigned int hdrSatLevel[clm_HDR_MAX]; // Clear count considered saturated
+unsigned int hdrExtSat[clm_HDR_MAX]; // Extended clear value at which each exposure saturates
+const clm_Exposure hdrDefault[2] = {
+    {0xC0, clm_AGAIN_16X}, // 154 ms, 16x: dark matte targets
+    {0xF6, clm_AGAIN_1X} // 24 ms, 1x: bright glossy targets
+};
+int hdrCount = 0;
+int hdrAverage = 1;
+
+#define clm_CYCLE_TICKS (CORE_TICKS_PER_MS * 12 / 5) // 2.4 ms integration step
+#define clm_READ_MARGIN (CORE_TICKS_PER_MS / 5) // read 0.2 ms after the nominal end of a cycle
+
+/***	CLM_InitStep
 **
 **	Parameters:
-**		
+**      int step - Step to be run (0 first).
 **
 **	Return Value:
-**		
+**      int - Microseconds to wait before the next step, boot_DONE after the last one,
+**      boot_FAILED if a sensor did not answer.
 **
 **	Description:
-**		This function initializes the colorimeter module by configuring the I2C interface and setting the integration time.
+**		This function runs one step of the sensors setup (boot task, see boot.h). All the sensors
+**      are powered on together in the first step and configured after a single 2.4 ms warm-up,
+**      instead of one warm-up per sensor. A sensor that fails does not stop the setup of the
+**      others, the error is reported by the last step. The time the integration is enabled is
+**      kept for CLM_FirstSampleStep.
 **      
 **          
 */
-void CLM_Init() {
-    I2C_Init(400000); // 400kHz
+int CLM_InitStep(int step) {
+    int err;
+    
+    if (step == 0) {
+        clmInitError = I2C_Init(i2c_FREQ_400K) ? i2c_OK : i2c_ERR_BUS; // 400kHz, maximum rate supported by the TCS34725
+        
+#if CLM_MUX_ENABLED
+        for (int i = 0; i < CLM_SENSOR_COUNT; i++)
+            CLM_AddSensor(i);
+#else
+        CLM_AddSensor(clm_MUX_NONE);
+#endif
+        
+        // Power on first: RGBC can start 2.4 ms after PON
+        for (int i = 0; i < sensorCount; i++) {
+            err = CLM_UpdateRegister(&sensors[i], clm_ENABLE, clm_ENABLE_PON);
+            if (err && !clmInitError)
+                clmInitError = err;
+        }
+        return clm_PON_US;
+    }
+    
+    CLM_SetHDR(hdrDefault, 2, 1);
     
     // Max RGBC Count = (256 - ATIME)  1024 up to a maximum of 65535.
-    CLM_Config(100); // Integration time: 100ms -> ATIME = 214 (0xD6)
+    for (int i = 0; i < sensorCount; i++) {
+        err = CLM_Config(&sensors[i], SETTINGS_Get(settings_ITIME)); // Default 100ms -> ATIME = 214 (0xD6)
+        if (err && !clmInitError)
+            clmInitError = err;
+    }
+    clmStartTime = BOOT_GetTime();
+    
+    return clmInitError ? boot_FAILED : boot_DONE;
+}
+
+/***	CLM_FirstSampleStep
+**
+**	Parameters:
+**      int step - Step to be run (0 first).
+**
+**	Return Value:
+**      int - Microseconds to wait before the next step, boot_DONE when the first sensor has a valid
+**      sample, boot_FAILED if it does not come.
+**
+**	Description:
+**		This function waits for the first integration cycle started by CLM_InitStep (boot task, see boot.h),
+**      so the boot report includes the time to the first valid sample. The first wait is counted
+**      from the time CLM_InitStep enabled the integration, not from the time this task is added.
+**      
+**          
+*/
+int CLM_FirstSampleStep(int step) {
+    clm_Sensor *sensor = &sensors[0];
+    unsigned char status;
+    
+    if (step == 0) {
+        unsigned int ready = clmStartTime + (256 - sensor->shadow[clm_ATIME] + 1) * 2400; // 2.4 ms init + cycles * 2.4 ms
+        unsigned int time = BOOT_GetTime();
+        return time < ready ? ready - time : 0;
+    }
+    
+    if (CLM_ReadRegisters(sensor, clm_STATUS, &status, 1))
+        return boot_FAILED;
+    if (status & clm_STATUS_AVALID)
+        return boot_DONE;
+    return step <= clm_FIRST_SAMPLE_POLLS ? clm_FIRST_SAMPLE_POLL_US : boot_FAILED;
+}
+
+/***	CLM_AddSensor
+**
+**	Parameters:
+**      unsigned char muxChannel - TCA9548A channel of the sensor, clm_MUX_NONE if it is directly on the bus.
+**
+**	Return Value:
+**      clm_Sensor * - The sensor handle, 0 if clm_MAX_SENSORS sensors are already registered.
+**
+**	Description:
+**		This function registers a sensor with the identity calibration and an empty register shadow.
+**      
+**          
+*/
+clm_Sensor *CLM_AddSensor(unsigned char muxChannel) {
+    if (sensorCount >= clm_MAX_SENSORS)
+        return 0;
+    
+    clm_Sensor *sensor = &sensors[sensorCount];
+    memset(sensor, 0, sizeof(clm_Sensor));
+    sensor->index = sensorCount;
+    sensor->muxChannel = muxChannel;
+    sensor->iGain = 4;
+    for (int i = 0; i < 4; i++)
+        sensor->calibration.gain[i] = clm_GAIN_ONE;
+    
+    sensorCount++;
+    return sensor;
+}
+
+/***	CLM_GetSensor
+**
+**	Parameters:
+**      int index - Sensor index, in registration order.
+**
+**	Return Value:
+**      clm_Sensor * - The sensor handle, 0 if the index is not valid.
+**
+**	Description:
+**		This function returns the handle of a registered sensor.
+**      
+**          
+*/
+clm_Sensor *CLM_GetSensor(int index) {
+    return index >= 0 && index < sensorCount ? &sensors[index] : 0;
+}
+
+/***	CLM_GetSensorCount
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - The number of registered sensors.
+**
+**	Description:
+**		This function returns the number of registered sensors.
+**      
+**          
+*/
+int CLM_GetSensorCount() {
+    return sensorCount;
+}
+
+/***	CLM_Transfer
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      const unsigned char *writeData - Bytes sent to the sensor (command byte first).
+**      int writeLen - Number of bytes to send.
+**      unsigned char *readData - Buffer receiving the bytes read after a repeated start.
+**      int readLen - Number of bytes to read (0 for a write only transaction).
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function executes one transaction with the sensor through the I2C queue.
+**      When the sensor sits on another TCA9548A channel, the channel selection is queued together
+**      with it and chained to it, so the two transactions run back-to-back, the sensor is not accessed
+**      if the selection fails and the selection is not sent if the queue has no room for both.
+**      After a failure the shadow copies of all the sensors are invalidated: a sensor reset or the
+**      bus recovery leaves their registers unknown, so the next CLM_RestoreConfig rewrites all of them.
+**      
+**          
+*/
+int CLM_Transfer(clm_Sensor *sensor, const unsigned char *writeData, int writeLen, unsigned char *readData, int readLen) {
+    i2c_Transaction select, transfer;
+    i2c_Transaction *list[2];
+    unsigned char channel;
+    int count = 0;
+    
+    select.status = i2c_OK;
+    if (sensor->muxChannel != clm_MUX_NONE && sensor->muxChannel != muxCurrent) {
+        channel = 1 << sensor->muxChannel; // One channel enabled
+        CLM_SetTransaction(&select, clm_MUX_ADDR, &channel, 1, 0, 0);
+        select.flags = i2c_FLAG_CHAIN;
+        list[count++] = &select;
+    }
+    CLM_SetTransaction(&transfer, clm_I2C_ADDR, writeData, writeLen, readData, readLen);
+    list[count++] = &transfer;
+    
+    int err = I2C_SubmitList(list, count);
+    if (!err)
+        err = I2C_Wait(&transfer);
+    if (!err && sensor->muxChannel != clm_MUX_NONE)
+        muxCurrent = sensor->muxChannel;
+    
+    if (err) {
+        muxCurrent = clm_MUX_NONE; // Select the channel again at the next transaction
+        for (int i = 0; i < sensorCount; i++)
+            sensors[i].shadowValid = 0; // Rewrite every register at the next configuration
+        sensor->busErrors++;
+    }
+    return err;
+}
+
+/***	CLM_SetTransaction
+**
+**	Parameters:
+**      i2c_Transaction *transaction - Descriptor to be filled.
+**      unsigned char address - Slave address.
+**      const unsigned char *writeData - Bytes to send.
+**      int writeLen - Number of bytes to send.
+**      unsigned char *readData - Buffer receiving the bytes read.
+**      int readLen - Number of bytes to read.
+**
+**	Return Value:
+**
+**	Description:
+**		This function fills a blocking (no callback, not chained) transaction descriptor.
+**      
+**          
+*/
+void CLM_SetTransaction(i2c_Transaction *transaction, unsigned char address, const unsigned char *writeData, int writeLen, unsigned char *readData, int readLen) {
+    transaction->address = address;
+    transaction->flags = 0;
+    transaction->writeData = writeData;
+    transaction->writeLen = writeLen;
+    transaction->readData = readData;
+    transaction->readLen = readLen;
+    transaction->callback = 0;
+    transaction->context = 0;
 }
 
 /***	CLM_Config
 **
 **	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
 **      int itime - Integration time in milliseconds.
 **
 **	Return Value:
-**		
+**      int - i2c_OK or the I2C error code.
 **
 **	Description:
-**		This function configures the colorimeter module with the specified integration time.
-**      It sets up the ENABLE, ATIME, and CONTROL registers.
+**		This function configures the colorimeter module with the specified integration time,
+**      the gain and the wait time settings. It sets up the ENABLE, ATIME, WTIME and CONTROL registers.
 **      
 **          
 */
-void CLM_Config(int itime) {
-    iTime = itime;
+int CLM_Config(clm_Sensor *sensor, int itime) {
+    unsigned char atime = 256 - (itime / 2.4); // ATIME = 256 - Integration Time / 2.4 ms
+    unsigned char control = CLM_GainToControl(SETTINGS_Get(settings_GAIN));
+    unsigned int wait = SETTINGS_Get(settings_WAIT) * 5 / 12; // 2.4 ms steps
+    unsigned char regs[2];
+    int err;
+    
+    sensor->iTime = itime;
+    sensor->baseAtime = atime;
+    sensor->baseControl = control;
+    sensor->baseWait = wait > 256 ? 256 : wait;
     
-    // Setup ENABLE register
-    I2C_MasterStart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_WRITE);
-    I2C_MasterSend(0x80 | 0x00); // Command bit + ENABLE register
-    I2C_MasterSend(0x03); // PON & AEN enabled
-    I2C_MasterStop();
-    TIMER2_DelayMS(10);
+    // Power on first: RGBC can start 2.4 ms after PON
+    if (!(sensor->shadowValid & (1 << clm_ENABLE)) || !(sensor->shadow[clm_ENABLE] & clm_ENABLE_PON)) {
+        err = CLM_UpdateRegister(sensor, clm_ENABLE, clm_ENABLE_PON);
+        if (err)
+            return err;
+        TIMER2_DelayMS(clm_PON_US / 1000 + 1);
+    }
+    
+    // Wait time between the cycles, used only if WEN is set
+    if (sensor->baseWait) {
+        err = CLM_UpdateRegister(sensor, clm_WTIME, 256 - sensor->baseWait);
+        if (err)
+            return err;
+    }
     
-    // Setup ATIME register
-    I2C_MasterStart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_WRITE);
-    I2C_MasterSend(0x80 | 0x01); // Command bit + ATIME register
-    I2C_MasterSend(256 - (itime / 2.4)); // ATIME = 256 - Integration Time / 2.4 ms
-    I2C_MasterStop();
-    TIMER2_DelayMS(10);
+    // Setup ENABLE and ATIME registers in one burst
+    regs[0] = clm_ENABLE_PON | clm_ENABLE_AEN | (sensor->baseWait ? clm_ENABLE_WEN : 0); // PON & AEN (& WEN) enabled
+    regs[1] = atime;
+    err = CLM_UpdateRegisters(sensor, clm_ENABLE, regs, 2);
     
     // Setup CONTROL register (gain)
-    I2C_MasterStart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_WRITE);
-    I2C_MasterSend(0x80 | 0x0F); // Command bit + CONTROL register
-    I2C_MasterSend(0x01); // Gain = 4x
-    I2C_MasterStop();   
+    if (!err)
+        err = CLM_UpdateRegister(sensor, clm_CONTROL, control);
+    
+    CLM_UpdateScale(sensor, atime, control);
+    return err;
+}
+
+/***	CLM_GainToControl
+**
+**	Parameters:
+**      int gain - Analog gain (1, 4, 16 or 60).
+**
+**	Return Value:
+**      unsigned char - CONTROL register value (AGAIN), the highest gain not above the requested one.
+**
+**	Description:
+**		This function converts the gain setting to the AGAIN field.
+**      
+**          
+*/
+unsigned char CLM_GainToControl(int gain) {
+    if (gain >= 60)
+        return clm_AGAIN_60X;
+    if (gain >= 16)
+        return clm_AGAIN_16X;
+    if (gain >= 4)
+        return clm_AGAIN_4X;
+    return clm_AGAIN_1X;
+}
+
+/***	CLM_UpdateScale
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char atime - ATIME register value.
+**      unsigned char control - CONTROL register value (AGAIN).
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function recomputes the saturation count and the lux scale for an integration time and gain.
+**      
+**          
+*/
+void CLM_UpdateScale(clm_Sensor *sensor, unsigned char atime, unsigned char control) {
+    unsigned int cycles = 256 - atime;
+    
+    sensor->iGain = clm_GainFactor[control & 0x03];
+    
+    // Max RGBC Count = (256 - ATIME) * 1024 up to a maximum of 65535
+    sensor->maxCount = cycles >= 64 ? 65535 : cycles * 1024;
+    
+    // Lux = (R*Rc + G*Gc + B*Bc) / 1000 * DF / (ATIME_ms * gain), ATIME_ms = cycles * 2.4
+    // -> scale = DF / (2400 * cycles * gain), precomputed so a sample costs one multiply
+    sensor->luxScale = ((unsigned long long) clm_DF << clm_LUX_SHIFT) / (2400 * cycles * sensor->iGain);
+}
+
+/***	CLM_WriteRegisters
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - First register address.
+**      const unsigned char *values - Values to be written.
+**      int len - Number of consecutive registers (up to clm_SHADOW_SIZE).
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function writes consecutive registers in one I2C transaction, using the
+**      auto-increment protocol of the command register, and updates the shadow copy.
+**      After a failure the shadow copy is invalidated by CLM_Transfer.
+**      
+**          
+*/
+int CLM_WriteRegisters(clm_Sensor *sensor, unsigned char reg, const unsigned char *values, int len) {
+    unsigned char data[clm_SHADOW_SIZE + 1];
+    
+    if (len > clm_SHADOW_SIZE)
+        len = clm_SHADOW_SIZE;
+    
+    data[0] = clm_CMD | clm_CMD_AUTOINC | reg; // Command bit + auto-increment + first register
+    memcpy(data + 1, values, len);
+    
+    int err = CLM_Transfer(sensor, data, len + 1, 0, 0);
+    if (!err) {
+        for (int i = 0; i < len; i++)
+            CLM_ShadowStore(sensor, reg + i, values[i]);
+    }
+    return err;
+}
+
+/***	CLM_ReadRegisters
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - First register address.
+**      unsigned char *values - Buffer receiving the values.
+**      int len - Number of consecutive registers.
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function reads consecutive registers in one I2C transaction (auto-increment protocol).
+**      
+**          
+*/
+int CLM_ReadRegisters(clm_Sensor *sensor, unsigned char reg, unsigned char *values, int len) {
+    unsigned char command = clm_CMD | clm_CMD_AUTOINC | reg;
+    
+    int err = CLM_Transfer(sensor, &command, 1, values, len);
+    if (!err) {
+        for (int i = 0; i < len; i++)
+            CLM_ShadowStore(sensor, reg + i, values[i]);
+    }
+    return err;
+}
+
+/***	CLM_ReadRegister
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - Register address.
+**
+**	Return Value:
+**      unsigned char - The register value, 0 if the read fails.
+**
+**	Description:
+**		This function reads one register of the colorimeter module.
+**      
+**          
+*/
+unsigned char CLM_ReadRegister(clm_Sensor *sensor, unsigned char reg) {
+    unsigned char value = 0;
+    CLM_ReadRegisters(sensor, reg, &value, 1);
+    return value;
+}
+
+/***	CLM_UpdateRegisters
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - First register address.
+**      const unsigned char *values - Wanted values of the consecutive registers.
+**      int len - Number of registers.
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function compares the wanted values with the shadow copy and writes, in a single burst,
+**      only the span between the first and the last register whose value changes.
+**      Nothing is sent on the bus if all the registers already hold the wanted value.
+**      
+**          
+*/
+int CLM_UpdateRegisters(clm_Sensor *sensor, unsigned char reg, const unsigned char *values, int len) {
+    int first = -1, last = -1;
+    
+    for (int i = 0; i < len; i++) {
+        if (!CLM_ShadowIs(sensor, reg + i, values[i])) {
+            if (first < 0)
+                first = i;
+            last = i;
+        }
+    }
+    
+    if (first < 0)
+        return i2c_OK;
+    return CLM_WriteRegisters(sensor, reg + first, values + first, last - first + 1);
+}
+
+/***	CLM_UpdateRegister
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - Register address.
+**      unsigned char value - Wanted value.
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function writes one register only if its shadow copy holds a different value.
+**      
+**          
+*/
+int CLM_UpdateRegister(clm_Sensor *sensor, unsigned char reg, unsigned char value) {
+    return CLM_UpdateRegisters(sensor, reg, &value, 1);
+}
+
+/***	CLM_ShadowIs
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - Register address.
+**      unsigned char value - Value to compare.
+**
+**	Return Value:
+**      int - 1 if the shadow copy of the register is valid and equal to value.
+**
+**	Description:
+**		This function checks the shadow copy of a configuration register.
+**      
+**          
+*/
+int CLM_ShadowIs(clm_Sensor *sensor, unsigned char reg, unsigned char value) {
+    return reg < clm_SHADOW_SIZE && (sensor->shadowValid & (1 << reg)) && sensor->shadow[reg] == value;
+}
+
+/***	CLM_ShadowStore
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char reg - Register address.
+**      unsigned char value - Value written to or read from the sensor.
+**
+**	Return Value:
+**
+**	Description:
+**		This function updates the shadow copy of a configuration register (data registers are not cached).
+**      
+**          
+*/
+void CLM_ShadowStore(clm_Sensor *sensor, unsigned char reg, unsigned char value) {
+    if (reg < clm_SHADOW_SIZE) {
+        sensor->shadow[reg] = value;
+        sensor->shadowValid |= 1 << reg;
+    }
 }
 
 /***	CLM_GetID
 **
 **	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
 **
 **	Return Value:
 **      unsigned char - The ID of the colorimeter.
@@ -77,26 +556,18 @@ void CLM_Config(int itime) {
 **      
 **          
 */
-unsigned char CLM_GetID() {
-    I2C_MasterStart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_WRITE); // Colorimeter address
-    I2C_MasterSend(0x80 | clm_ID_ADDR);
-    I2C_MasterRestart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_READ);
-    unsigned char id = I2C_MasterReceive();
-    I2C_MasterACK(1);
-    I2C_MasterStop();
-    
-    return id;
+unsigned char CLM_GetID(clm_Sensor *sensor) {
+    return CLM_ReadRegister(sensor, clm_ID_ADDR);
 }
 
 /***	CLM_I2CGetColorData
 **
 **	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
 **      unsigned char *colors - Pointer to an array to store the color data.
 **
 **	Return Value:
-**		
+**      int - i2c_OK or the I2C error code.
 **
 **	Description:
 **		This function reads the raw color data from the colorimeter module via I2C.
@@ -104,48 +575,682 @@ unsigned char CLM_GetID() {
 **      
 **          
 */
-void CLM_I2CGetColorData(unsigned char *colors) {
-    I2C_MasterStart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_WRITE); // Colorimeter address
-    I2C_MasterSend(0x80 | clm_CDATAL);
-    I2C_MasterRestart();
-    I2C_MasterSend((clm_I2C_ADDR << 1) | i2c_MASTER_READ);
-    
+int CLM_I2CGetColorData(clm_Sensor *sensor, unsigned char *colors) {
     // Read color low and high data
-    for (int i = 0; i < 8; i++) {
-        colors[i] = I2C_MasterReceive();
-        I2C_MasterACK(i >= 7 ? 1 : 0);
+    return CLM_ReadRegisters(sensor, clm_CDATAL, colors, 8);
+}
+
+/***	CLM_GetSample
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      clm_Sample *sample - Pointer to the structure that receives the reading.
+**
+**	Return Value:
+**      int - i2c_OK, clm_ERR_NOT_VALID if no integration cycle has completed (AVALID clear), or the
+**      I2C error code (also stored in sample->status, the values are cleared).
+**
+**	Description:
+**		This function reads STATUS and the RGBC data in one burst, applies the calibration and derives the IR-compensated channels,
+**      the illuminance and the correlated colour temperature (TCS34725 DN40).
+**      IR, lux and CCT use the dark-corrected counts: the white balance gains only scale c, r, g, b,
+**      the colour output, otherwise on a white target R + G + B = 2C and the IR estimate equals C.
+**      Only integer math is used: the lux scale for the current ATIME/gain is precomputed by CLM_Config.
+**          
+*/
+int CLM_GetSample(clm_Sensor *sensor, clm_Sample *sample) {
+    unsigned char values[9]; // status, 2c, 2r, 2g, 2b
+    unsigned short *raw = sample->raw; // c, r, g, b
+    unsigned int dark[4]; // raw - dark offset
+    unsigned short *dst[4] = {&sample->c, &sample->r, &sample->g, &sample->b};
+    
+    sample->status = CLM_ReadRegisters(sensor, clm_STATUS, values, 9);
+    if (!sample->status && !(values[0] & clm_STATUS_AVALID))
+        sample->status = clm_ERR_NOT_VALID;
+    if (sample->status) {
+        memset(sample, 0, offsetof(clm_Sample, status));
+        return sample->status;
     }
-    I2C_MasterStop();
+    
+    for (int i = 0; i < 4; i++)
+        raw[i] = (values[2 * i + 2] << 8) | values[2 * i + 1];
+    
+    sample->saturated = raw[0] >= sensor->maxCount;
+    
+    // Apply dark offset, then white balance for the colour output: (raw - offset) * gain
+    for (int i = 0; i < 4; i++) {
+        dark[i] = raw[i] > sensor->calibration.offset[i] ? raw[i] - sensor->calibration.offset[i] : 0;
+        unsigned int v = ((unsigned long long) dark[i] * sensor->calibration.gain[i]) >> 16;
+        *dst[i] = v > 65535 ? 65535 : v;
+    }
+    
+    // IR = (R + G + B - C) / 2
+    int sumIr = ((int) dark[1] + dark[2] + dark[3] - dark[0]) / 2;
+    unsigned int ir = sumIr > 0 ? sumIr : 0;
+    sample->ir = ir;
+    
+    sample->rc = dark[1] > ir ? dark[1] - ir : 0;
+    sample->gc = dark[2] > ir ? dark[2] - ir : 0;
+    sample->bc = dark[3] > ir ? dark[3] - ir : 0;
+    
+    int sum = clm_R_COEF * sample->rc + clm_G_COEF * sample->gc + clm_B_COEF * sample->bc;
+    if (sum < 0 || sample->saturated)
+        sample->lux = 0;
+    else
+        sample->lux = ((unsigned long long) sum * sensor->luxScale) >> clm_LUX_SHIFT;
+    
+    // CCT = CT_Coef * B' / R' + CT_Offset
+    if (sample->rc == 0)
+        sample->cct = 0;
+    else
+        sample->cct = clm_CT_COEF * sample->bc / sample->rc + clm_CT_OFFSET;
+    return i2c_OK;
 }
 
-/***	CLM_GetColorData
+/***	CLM_SampleToColors
 **
 **	Parameters:
+**      clm_Sample *sample - Pointer to a reading obtained from CLM_GetSample.
 **      unsigned int *colors - Pointer to an array to store the normalized RGB color data.
 **
 **	Return Value:
 **		
 **
 **	Description:
-**		This function reads the raw color data from the colorimeter module and normalizes the RGB values.
-**      It stores the normalized data in the provided array.
+**		This function normalizes the RGB values of a reading against its clear channel.
 **      
 **          
 */
-void CLM_GetColorData(unsigned int *colors) {
-    unsigned char values[8]; // 2c, 2r, 2g, 2b
-    CLM_I2CGetColorData(values);
-    
-    int clear = (values[1] << 8) | values[0];
-    
+void CLM_SampleToColors(clm_Sample *sample, unsigned int *colors) {
     // Normalize RGB
-    if (clear == 0) {
+    if (sample->c == 0) {
         for (int i = 0; i < 3; i++)
             colors[i] = 0;
     } else {
-        colors[0] = ((float) ((values[3] << 8) | values[2]) / clear) * 255;
-        colors[1] = ((float) ((values[5] << 8) | values[4]) / clear) * 255;
-        colors[2] = ((float) ((values[7] << 8) | values[6]) / clear) * 255;
+        colors[0] = (sample->r * 255) / sample->c;
+        colors[1] = (sample->g * 255) / sample->c;
+        colors[2] = (sample->b * 255) / sample->c;
     }
 }
+
+/***	CLM_GetColorData
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned int *colors - Pointer to an array to store the normalized RGB color data.
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code (colors is left unchanged).
+**
+**	Description:
+**		This function reads the raw color data from the colorimeter module and normalizes the RGB values.
+**      It stores the normalized data in the provided array.
+**      
+**          
+*/
+int CLM_GetColorData(clm_Sensor *sensor, unsigned int *colors) {
+    clm_Sample sample;
+    int err = CLM_GetSample(sensor, &sample);
+    if (!err)
+        CLM_SampleToColors(&sample, colors);
+    return err;
+}
+
+/***	CLM_CaptureReference
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned short *channels - Pointer to an array of 4 elements receiving the averaged raw counts.
+**
+**	Return Value:
+**      int - i2c_OK, clm_ERR_NOT_VALID if a cycle does not complete, or the I2C error code.
+**
+**	Description:
+**		This function averages clm_CAL_SAMPLES raw readings, each from a new integration cycle with the
+**      settings of CLM_Config. CLM_RestoreConfig restarts the cycle before each reading (AVALID cleared),
+**      then the reading waits for the 2.4 ms init, the integration and the wait time, and checks AVALID
+**      in the same burst as the data, retried every clm_READ_MARGIN up to clm_VALID_POLLS times.
+**      It is used to capture the dark and white references during calibration.
+**      
+**          
+*/
+int CLM_CaptureReference(clm_Sensor *sensor, unsigned short *channels) {
+    unsigned int sum[4] = {0, 0, 0, 0};
+    clm_Sample sample;
+    
+    for (int n = 0; n < clm_CAL_SAMPLES; n++) {
+        int err = CLM_RestoreConfig(sensor);
+        unsigned int ready = TIMER_GetCoreTicks() + clm_CYCLE_TICKS + CLM_GetPeriod(sensor) + clm_READ_MARGIN;
+        
+        for (int polls = 0; !err; polls++) {
+            while ((int) (TIMER_GetCoreTicks() - ready) < 0)
+                ;
+            err = CLM_GetSample(sensor, &sample);
+            if (err != clm_ERR_NOT_VALID || polls == clm_VALID_POLLS)
+                break;
+            err = i2c_OK;
+            ready += clm_READ_MARGIN;
+        }
+        if (err)
+            return err;
+        for (int i = 0; i < 4; i++)
+            sum[i] += sample.raw[i];
+    }
+    
+    for (int i = 0; i < 4; i++)
+        channels[i] = sum[i] / clm_CAL_SAMPLES;
+    return i2c_OK;
+}
+
+/***	CLM_ComputeCalibration
+**
+**	Parameters:
+**      clm_Calibration *cal - Receives the offsets and gains.
+**      unsigned short *dark - Raw c, r, g, b counts with the sensor covered.
+**      unsigned short *white - Raw c, r, g, b counts on the white reference.
+**
+**	Return Value:
+**      int - 0 on success, -1 if the references are not usable (white not brighter than dark).
+**
+**	Description:
+**		This function computes the per-channel offsets and gains, without making them active,
+**      so that a calibration of several sensors can be applied only when all of them succeed.
+**      The gains equalize R, G and B to the clear channel on the white reference, 
+**      so that a white target normalizes to 255, 255, 255.
+**      
+**          
+*/
+int CLM_ComputeCalibration(clm_Calibration *cal, unsigned short *dark, unsigned short *white) {
+    for (int i = 0; i < 4; i++) {
+        if (white[i] <= dark[i])
+            return -1;
+    }
+    
+    unsigned int clearSpan = white[0] - dark[0];
+    for (int i = 0; i < 4; i++) {
+        cal->offset[i] = dark[i];
+        cal->gain[i] = ((unsigned long long) clearSpan << 16) / (white[i] - dark[i]);
+    }
+    
+    return 0;
+}
+
+/***	CLM_SetCalibration
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      clm_Calibration *cal - Calibration computed by CLM_ComputeCalibration.
+**
+**	Return Value:
+**
+**	Description:
+**		This function makes a calibration active. Use CLM_SaveCalibration to persist it.
+**      
+**          
+*/
+void CLM_SetCalibration(clm_Sensor *sensor, clm_Calibration *cal) {
+    sensor->calibration = *cal;
+}
+
+/***	CLM_SaveCalibration
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - SPIFLASH_OK or the SPIFLASH_ProgramVerify error.
+**
+**	Description:
+**		This function writes the active calibration of every sensor over the older copy and verifies it.
+**      The current copy is changed only after the check, so a failed save keeps the last good one.
+**      
+**          
+*/
+int CLM_SaveCalibration() {
+    clm_CalibrationBlock block;
+    int copy = !clmCalCopy;
+    unsigned int addr = SPIFLASH_CAL_ADDR + copy * SPIFLASH_SECTOR_SIZE;
+    
+    memset(&block, 0xFF, sizeof(block));
+    block.magic = clm_CAL_MAGIC;
+    block.count = sensorCount;
+    block.sequence = clmCalSequence + 1;
+    for (int i = 0; i < sensorCount; i++)
+        block.sensors[i] = sensors[i].calibration;
+    block.crc = SPIFLASH_CRC16(0xFFFF, (unsigned char *) &block, offsetof(clm_CalibrationBlock, crc));
+    
+    SPIFLASH_EraseSector(addr);
+    int err = SPIFLASH_ProgramVerify(addr, (unsigned char *) &block, sizeof(block));
+    if (err)
+        return err;
+    
+    clmCalCopy = copy;
+    clmCalSequence = block.sequence;
+    return SPIFLASH_OK;
+}
+
+/***	CLM_LoadCalibration
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - Number of sensors for which a valid calibration was loaded, the others use the identity calibration.
+**
+**	Description:
+**		This function reads the newest valid copy of the calibrations from SPI flash once (at boot).
+**      The sample path then uses the RAM copies only.
+**      
+**          
+*/
+int CLM_LoadCalibration() {
+    clm_CalibrationBlock block[2];
+    int valid[2];
+    
+    for (int i = 0; i < 2; i++)
+        valid[i] = CLM_ReadCalibration(i, &block[i]) == 0;
+    
+    if (!valid[0] && !valid[1])
+        return 0; // Identity calibration, the first save goes to copy 0
+    
+    // The sequence is compared as a difference so it can wrap around
+    clmCalCopy = !valid[0] || (valid[1] && (int) (block[1].sequence - block[0].sequence) > 0);
+    clmCalSequence = block[clmCalCopy].sequence;
+    
+    int loaded = block[clmCalCopy].count < sensorCount ? block[clmCalCopy].count : sensorCount;
+    for (int i = 0; i < loaded; i++)
+        sensors[i].calibration = block[clmCalCopy].sensors[i];
+    return loaded;
+}
+
+/***	CLM_ReadCalibration
+**
+**	Parameters:
+**      int copy - Copy to be read (0 or 1).
+**      clm_CalibrationBlock *block - Block read from the flash.
+**
+**	Return Value:
+**      int - 0 if the copy is valid, -1 otherwise.
+**
+**	Description:
+**		This function reads a copy of the calibrations and checks its magic and CRC.
+**      
+**          
+*/
+int CLM_ReadCalibration(int copy, clm_CalibrationBlock *block) {
+    SPIFLASH_Read(SPIFLASH_CAL_ADDR + copy * SPIFLASH_SECTOR_SIZE, (unsigned char *) block, sizeof(clm_CalibrationBlock));
+    
+    if (block->magic != clm_CAL_MAGIC || block->count > clm_MAX_SENSORS ||
+            block->crc != SPIFLASH_CRC16(0xFFFF, (unsigned char *) block, offsetof(clm_CalibrationBlock, crc)))
+        return -1;
+    return 0;
+}
+
+/***	CLM_SetExposure
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char atime - ATIME register value.
+**      unsigned char control - CONTROL register value (AGAIN).
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function restarts the RGBC integration with a new integration time and gain.
+**      ATIME and CONTROL are written only if their value changes (shadow cache), the ENABLE
+**      register is toggled so that the next valid data belongs to the new setting.
+**      
+**          
+*/
+int CLM_SetExposure(clm_Sensor *sensor, unsigned char atime, unsigned char control) {
+    unsigned char regs[2];
+    int err;
+    
+    regs[0] = clm_ENABLE_PON;
+    err = CLM_WriteRegisters(sensor, clm_ENABLE, regs, 1); // Stop the running cycle
+    if (!err)
+        err = CLM_UpdateRegister(sensor, clm_CONTROL, control);
+    if (err)
+        return err;
+    
+    // Start a new cycle, ATIME is part of the same burst only if it changes
+    regs[0] = clm_ENABLE_PON | clm_ENABLE_AEN;
+    regs[1] = atime;
+    err = CLM_WriteRegisters(sensor, clm_ENABLE, regs, CLM_ShadowIs(sensor, clm_ATIME, atime) ? 1 : 2);
+    
+    CLM_UpdateScale(sensor, atime, control);
+    return err;
+}
+
+/***	CLM_SetIntegrationTime
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned char atime - ATIME register value.
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function changes the integration time on the fly (e.g. for auto-exposure):
+**      one short transaction, only if the value changes, effective from the next cycle.
+**      
+**          
+*/
+int CLM_SetIntegrationTime(clm_Sensor *sensor, unsigned char atime) {
+    int err = CLM_UpdateRegister(sensor, clm_ATIME, atime);
+    CLM_UpdateScale(sensor, atime, sensor->shadow[clm_CONTROL]);
+    return err;
+}
+
+/***	CLM_RestoreConfig
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**
+**	Return Value:
+**      int - i2c_OK or the I2C error code.
+**
+**	Description:
+**		This function restores the integration time, gain and wait time set by CLM_Config (e.g. after HDR scans
+**      or a bus error). Registers whose shadow copy is not valid are always rewritten.
+**      
+**          
+*/
+int CLM_RestoreConfig(clm_Sensor *sensor) {
+    int err = i2c_OK;
+    
+    if (sensor->baseWait) // Written only if the shadow copy is lost
+        err = CLM_UpdateRegister(sensor, clm_WTIME, 256 - sensor->baseWait);
+    if (!err)
+        err = CLM_SetExposure(sensor, sensor->baseAtime, sensor->baseControl);
+    
+    if (!err && sensor->baseWait) // Wait from the end of the first cycle
+        err = CLM_UpdateRegister(sensor, clm_ENABLE, clm_ENABLE_PON | clm_ENABLE_AEN | clm_ENABLE_WEN);
+    return err;
+}
+
+/***	CLM_SetHDR
+**
+**	Parameters:
+**      const clm_Exposure *exposures - Integration time/gain pairs, from the strongest to the weakest.
+**      int count - Number of pairs (up to clm_HDR_MAX).
+**      int average - Number of merged samples averaged by CLM_HDRPoll.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function programs the HDR exposures and precomputes their scale factors,
+**      so that merging a reading costs one multiply per channel.
+**      
+**          
+*/
+void CLM_SetHDR(const clm_Exposure *exposures, int count, int average) {
+    if (count > clm_HDR_MAX)
+        count = clm_HDR_MAX;
+    
+    unsigned int strongest = (256 - exposures[0].atime) * clm_GainFactor[exposures[0].control & 0x03];
+    
+    for (int i = 0; i < count; i++) {
+        unsigned int cycles = 256 - exposures[i].atime;
+        unsigned int weight = cycles * clm_GainFactor[exposures[i].control & 0x03];
+        unsigned int maxc = cycles >= 64 ? 65535 : cycles * 1024;
+        
+        hdrExposures[i] = exposures[i];
+        hdrRatio[i] = ((unsigned long long) strongest << 16) / weight;
+        hdrSatLevel[i] = cycles >= 64 ? maxc : maxc * 3 / 4; // Ripple saturation at 75% for short ATIME
+        hdrExtSat[i] = ((unsigned long long) hdrSatLevel[i] * hdrRatio[i]) >> 16;
+    }
+    
+    hdrCount = count;
+    hdrAverage = average > 0 ? average : 1;
+    for (int i = 0; i < sensorCount; i++) {
+        sensors[i].hdrLastClear = 0;
+        CLM_HDRReset(&sensors[i]);
+    }
+}
+
+/***	CLM_HDRPoll
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**      unsigned int *channels - Pointer to an array of 4 elements receiving the c, r, g, b extended values.
+**
+**	Return Value:
+**      int - 0 on success, 1 if even the weakest exposure saturated, clm_PENDING while the merged
+**      sample is not complete (channels not written), a negative I2C error code,
+**      clm_ERR_NO_EXPOSURE if CLM_SetHDR has not been called.
+**
+**	Description:
+**		This function advances the extended dynamic range acquisition, to be called from the main loop
+**      after CLM_ScanStart. Like CLM_ScanPoll it starts an exposure, returns until nextEvent and then
+**      reads STATUS and RGBC in one burst, retrying every clm_READ_MARGIN while AVALID is clear.
+**      Each merged sample starts from the strongest exposure predicted not to saturate (from the
+**      previous reading) and falls back to weaker ones while the clear channel saturates; the accepted
+**      reading is scaled to counts of the strongest exposure and hdrAverage merged samples are averaged.
+**      
+**          
+*/
+int CLM_HDRPoll(clm_Sensor *sensor, unsigned int *channels) {
+    unsigned int now = TIMER_GetCoreTicks();
+    clm_Sample sample;
+    int idx = sensor->hdrIndex, err;
+    
+    if (hdrCount == 0)
+        return clm_ERR_NO_EXPOSURE;
+    if ((int) (now - sensor->nextEvent) < 0)
+        return clm_PENDING;
+    
+    if (sensor->state == clm_STATE_START) {
+        unsigned int cycle = (256 - hdrExposures[idx].atime) * clm_CYCLE_TICKS;
+        err = CLM_SetExposure(sensor, hdrExposures[idx].atime, hdrExposures[idx].control);
+        if (err) {
+            sensor->nextEvent = now + cycle; // Retry one cycle later
+            return err;
+        }
+        sensor->nextEvent = now + clm_CYCLE_TICKS + cycle + clm_READ_MARGIN; // 2.4 ms init + one cycle
+        sensor->state = clm_STATE_RUN;
+        sensor->validPolls = 0;
+        return clm_PENDING;
+    }
+    
+    err = CLM_GetSample(sensor, &sample);
+    if (err == clm_ERR_NOT_VALID && sensor->validPolls < clm_VALID_POLLS) {
+        sensor->validPolls++;
+        sensor->nextEvent = now + clm_READ_MARGIN; // The cycle is not over yet: follow the sensor clock
+        return clm_PENDING;
+    }
+    sensor->state = clm_STATE_START; // Every reading is followed by a new exposure
+    if (err)
+        return err;
+    
+    if (sample.raw[0] >= hdrSatLevel[idx]) {
+        if (idx < hdrCount - 1) {
+            sensor->hdrIndex++; // Fall back to the next weaker exposure
+            return clm_PENDING;
+        }
+        sensor->hdrSaturated = 1;
+    }
+    
+    for (int i = 0; i < 4; i++)
+        sensor->hdrSum[i] += ((unsigned long long) sample.raw[i] * hdrRatio[idx]) >> 16;
+    sensor->hdrLastClear = ((unsigned long long) sample.raw[0] * hdrRatio[idx]) >> 16;
+    sensor->hdrIndex = CLM_HDRPredict(sensor);
+    if (++sensor->hdrSamples < hdrAverage)
+        return clm_PENDING;
+    
+    for (int i = 0; i < 4; i++)
+        channels[i] = sensor->hdrSum[i] / hdrAverage;
+    
+    int result = sensor->hdrSaturated;
+    CLM_HDRReset(sensor);
+    return result;
+}
+
+/***	CLM_HDRReset
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**
+**	Return Value:
+**
+**	Description:
+**		This function discards the merged samples accumulated by CLM_HDRPoll.
+**      
+**          
+*/
+void CLM_HDRReset(clm_Sensor *sensor) {
+    for (int i = 0; i < 4; i++)
+        sensor->hdrSum[i] = 0;
+    sensor->hdrSamples = 0;
+    sensor->hdrSaturated = 0;
+    sensor->hdrIndex = CLM_HDRPredict(sensor);
+}
+
+/***	CLM_HDRPredict
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**
+**	Return Value:
+**      int - Index of the exposure to start the next merged sample from.
+**
+**	Description:
+**		This function returns the strongest exposure the last reading predicts to stay below 75% of saturation.
+**      
+**          
+*/
+int CLM_HDRPredict(clm_Sensor *sensor) {
+    for (int i = 0; i < hdrCount; i++) {
+        if (sensor->hdrLastClear < hdrExtSat[i] - hdrExtSat[i] / 4)
+            return i;
+    }
+    return hdrCount > 0 ? hdrCount - 1 : 0;
+}
+
+/***	CLM_NormalizeChannels
+**
+**	Parameters:
+**      unsigned int *channels - c, r, g, b values (e.g. from CLM_HDRPoll).
+**      unsigned int *colors - Pointer to an array to store the normalized RGB color data.
+**
+**	Return Value:
+**
+**	Description:
+**		This function normalizes 32-bit RGB values against their clear channel.
+**      
+**          
+*/
+void CLM_NormalizeChannels(unsigned int *channels, unsigned int *colors) {
+    for (int i = 0; i < 3; i++)
+        colors[i] = channels[0] ? ((unsigned long long) channels[i + 1] * 255) / channels[0] : 0;
+}
+
+/***	CLM_GetPeriod
+**
+**	Parameters:
+**      clm_Sensor *sensor - Sensor handle.
+**
+**	Return Value:
+**      unsigned int - Core timer ticks from one valid data to the next with the settings of CLM_Config.
+**
+**	Description:
+**		This function returns the length of an integration cycle; with a wait time the period also
+**      holds the wait and the 2.4 ms init that follows it.
+**      
+**          
+*/
+unsigned int CLM_GetPeriod(clm_Sensor *sensor) {
+    return (256 - sensor->baseAtime + (sensor->baseWait ? sensor->baseWait + 1 : 0)) * clm_CYCLE_TICKS;
+}
+
+/***	CLM_ScanStart
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function prepares the round-robin acquisition of all the registered sensors.
+**      The integration starts are staggered by period / sensorCount, so that reading one
+**      sensor overlaps with the integration of the others. With a wait time the period also
+**      holds the wait and the 2.4 ms init that follows it.
+**      
+**          
+*/
+void CLM_ScanStart() {
+    unsigned int now = TIMER_GetCoreTicks();
+    
+    for (int i = 0; i < sensorCount; i++) {
+        clm_Sensor *sensor = &sensors[i];
+        sensor->period = CLM_GetPeriod(sensor);
+        sensor->nextEvent = now + sensor->period / sensorCount * i;
+        sensor->state = clm_STATE_START;
+        CLM_HDRReset(sensor);
+    }
+}
+
+/***	CLM_ScanPoll
+**
+**	Parameters:
+**      clm_Sample *sample - Pointer to the structure that receives the reading.
+**
+**	Return Value:
+**      int - Index of the sensor that produced the sample, -1 if no sensor had new data.
+**      A failed read is returned with sample->status set, and the sensor is reprogrammed at its next turn.
+**
+**	Description:
+**		This function serves the most overdue sensor of the round-robin acquisition started by CLM_ScanStart:
+**      it either starts its integration (first call) or reads the completed cycle.
+**      The sensors run continuously, so each read only costs one STATUS + RGBC burst on the bus.
+**      The schedule runs on the MCU clock and the sensor on its own oscillator: when AVALID is not set
+**      yet the read is retried every clm_READ_MARGIN and the schedule takes the phase of the sensor;
+**      after clm_VALID_POLLS retries (sensor reset, AEN cleared) the sensor is reprogrammed.
+**      
+**          
+*/
+int CLM_ScanPoll(clm_Sample *sample) {
+    unsigned int now = TIMER_GetCoreTicks();
+    clm_Sensor *due = 0;
+    int lateness = -1;
+    
+    for (int i = 0; i < sensorCount; i++) {
+        int late = (int) (now - sensors[i].nextEvent);
+        if (late > lateness) {
+            lateness = late;
+            due = &sensors[i];
+        }
+    }
+    
+    if (!due)
+        return -1;
+    
+    if (due->state == clm_STATE_START) {
+        // (Re)start integration with the base settings
+        if (CLM_RestoreConfig(due)) {
+            due->nextEvent = now + due->period; // Retry one cycle later
+            return -1;
+        }
+        due->nextEvent = now + clm_CYCLE_TICKS + due->period + clm_READ_MARGIN; // 2.4 ms init + first cycle
+        due->state = clm_STATE_RUN;
+        due->validPolls = 0;
+        return -1;
+    }
+    
+    int err = CLM_GetSample(due, sample);
+    if (err == clm_ERR_NOT_VALID && due->validPolls < clm_VALID_POLLS) {
+        due->validPolls++;
+        due->nextEvent = now + clm_READ_MARGIN; // The cycle is not over yet: follow the sensor clock
+        return -1;
+    }
+    due->validPolls = 0;
+    if (err)
+        due->state = clm_STATE_START; // Reprogram the sensor after a bus error or a lost cycle
+    
+    // Keep the phase of the staggered schedule, resync if we fell behind a whole cycle
+    due->nextEvent += due->period;
+    if ((int) (now - due->nextEvent) >= 0)
+        due->nextEvent = now + due->period;
+    
+    return due->index;
+}
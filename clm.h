@@ -10,10 +10,27 @@
 #ifndef CLM_H
 #define	CLM_H
 
+#include "i2c.h"
+
 #define clm_I2C_ADDR 0x29
 
+/* TCA9548A I2C multiplexer */
+#define clm_MUX_ADDR 0x70
+#define clm_MUX_NONE 0xFF // sensor directly on the bus
+#define clm_MAX_SENSORS 8
+
+#define clm_CMD 0x80 // command register: select register
+#define clm_CMD_AUTOINC 0x20 // command register: auto-increment protocol
+
+#define clm_SHADOW_SIZE 0x10 // configuration registers cached in RAM
+
 /* register address */
+#define clm_ENABLE 0x00
+#define clm_ATIME 0x01
+#define clm_WTIME 0x03
+#define clm_CONTROL 0x0F
 #define clm_ID_ADDR 0x12
+#define clm_STATUS 0x13
 
 #define clm_CDATAL 0x14 // clear data low byte
 #define clm_CDATAH 0x15 // clear data low byte
@@ -24,10 +41,148 @@
 #define clm_BDATAL 0x1A // blue data low byte
 #define clm_BDATAH 0x1B // blue data low byte
 
+/* register bits */
+#define clm_ENABLE_PON 0x01 // power on
+#define clm_ENABLE_AEN 0x02 // RGBC enable
+#define clm_ENABLE_WEN 0x08 // wait enable: WTIME between RGBC cycles, the sensor draws ~65 uA instead of ~235 uA
+#define clm_STATUS_AVALID 0x01 // RGBC integration cycle completed
+
+/* boot timing */
+#define clm_PON_US 2400 // oscillator warm-up after PON, before AEN
+#define clm_FIRST_SAMPLE_POLL_US 500 // AVALID polling after the nominal end of the first cycle
+#define clm_FIRST_SAMPLE_POLLS 20
+
+#define clm_AGAIN_1X 0x00
+#define clm_AGAIN_4X 0x01
+#define clm_AGAIN_16X 0x02
+#define clm_AGAIN_60X 0x03
+
+/* lux and cct coefficients (TCS34725 DN40, channel coefficients scaled x1000) */
+#define clm_R_COEF 136
+#define clm_G_COEF 1000
+#define clm_B_COEF -444
+#define clm_DF 310 // device factor
+#define clm_CT_COEF 3810
+#define clm_CT_OFFSET 1391
+#define clm_LUX_SHIFT 24 // fraction bits of the lux scale factor
+
+/* one sensor reading with derived photometric values */
+typedef struct {
+    unsigned short raw[4]; // c, r, g, b counts as read from the sensor
+    unsigned short c, r, g, b; // calibrated channel counts (dark offset and white balance), colour output
+    unsigned short ir; // estimated IR content
+    unsigned short rc, gc, bc; // IR-compensated channels (dark offset only)
+    unsigned int lux; // illuminance (lux)
+    unsigned int cct; // correlated colour temperature (K)
+    unsigned char saturated; // clear channel reached the max count
+    int status; // i2c_OK or the I2C error code of the reading
+} clm_Sample;
+
+/*
+ * per-unit calibration: two copies at SPIFLASH_CAL_ADDR, one per sector. A save erases and programs the older
+ * copy with a higher sequence number, so a reset or a failed verify during the save leaves the previous
+ * calibrations valid.
+ */
+#define clm_CAL_MAGIC 0xCA1B
+#define clm_CAL_SAMPLES 8 // readings averaged for each reference
+#define clm_GAIN_ONE 0x10000 // 1.0 in Q16
+
+typedef struct {
+    unsigned short offset[4]; // dark counts (c, r, g, b)
+    unsigned int gain[4]; // Q16 channel gains (c, r, g, b)
+} clm_Calibration;
+
+typedef struct {
+    unsigned short magic; // clm_CAL_MAGIC
+    unsigned short count; // sensors stored
+    unsigned int sequence; // incremented at every save
+    clm_Calibration sensors[clm_MAX_SENSORS]; // by sensor index
+    unsigned short crc; // SPIFLASH_CRC16 of the fields above
+} clm_CalibrationBlock;
+
+/* HDR acquisition */
+#define clm_HDR_MAX 4
+#define clm_ERR_NO_EXPOSURE -16 // CLM_HDRPoll: no exposure programmed by CLM_SetHDR
+#define clm_ERR_NOT_VALID -17 // CLM_GetSample: AVALID clear, no integration cycle completed
+#define clm_PENDING 2 // CLM_HDRPoll: merged sample not complete yet
+
+typedef struct {
+    unsigned char atime; // ATIME register value
+    unsigned char control; // CONTROL register value (AGAIN)
+} clm_Exposure;
+
+/* round-robin scheduler states */
+#define clm_STATE_START 0 // integration to be started
+#define clm_STATE_RUN 1 // integrating, read at nextEvent
+#define clm_VALID_POLLS 10 // AVALID retries (clm_READ_MARGIN apart) before the sensor is reprogrammed
+
+/* sensor instance */
+typedef struct {
+    unsigned char index; // position in the sensor table
+    unsigned char muxChannel; // TCA9548A channel or clm_MUX_NONE
+    unsigned char shadow[clm_SHADOW_SIZE]; // configuration registers copy
+    unsigned short shadowValid; // bit n set when shadow[n] matches the sensor
+    int iTime; // integration time requested by CLM_Config (ms)
+    int iGain; // current analog gain
+    unsigned int maxCount; // saturation count for the current ATIME
+    unsigned int luxScale; // DF / CPL in Q24, see CLM_UpdateScale
+    unsigned char baseAtime, baseControl; // settings requested by CLM_Config
+    unsigned short baseWait; // wait steps (2.4 ms) between the cycles of CLM_Config, 0 = no wait
+    clm_Calibration calibration; // active calibration
+    unsigned int hdrLastClear; // last merged HDR clear value
+    unsigned char hdrIndex; // HDR exposure in use
+    unsigned char hdrSaturated; // a merged sample saturated at the weakest exposure
+    unsigned short hdrSamples; // merged samples accumulated in hdrSum
+    unsigned long long hdrSum[4]; // c, r, g, b sums of the merged samples
+    unsigned char state; // scheduler state
+    unsigned int period; // integration cycle (core timer ticks)
+    unsigned int nextEvent; // core timer tick of the next scheduler action
+    unsigned char validPolls; // reads retried while AVALID was clear
+    unsigned int busErrors; // failed transactions
+} clm_Sensor;
+
 /* public functions */
-void CLM_Init();
-unsigned char CLM_GetID();
-void CLM_GetColorData(unsigned int *colors);
+int CLM_InitStep(int step);
+int CLM_FirstSampleStep(int step);
+clm_Sensor *CLM_AddSensor(unsigned char muxChannel);
+clm_Sensor *CLM_GetSensor(int index);
+int CLM_GetSensorCount();
+void CLM_ScanStart();
+int CLM_ScanPoll(clm_Sample *sample);
+int CLM_Config(clm_Sensor *sensor, int itime);
+unsigned char CLM_GetID(clm_Sensor *sensor);
+int CLM_GetColorData(clm_Sensor *sensor, unsigned int *colors);
+int CLM_GetSample(clm_Sensor *sensor, clm_Sample *sample);
+void CLM_SampleToColors(clm_Sample *sample, unsigned int *colors);
+int CLM_CaptureReference(clm_Sensor *sensor, unsigned short *channels);
+int CLM_ComputeCalibration(clm_Calibration *cal, unsigned short *dark, unsigned short *white);
+void CLM_SetCalibration(clm_Sensor *sensor, clm_Calibration *cal);
+int CLM_SaveCalibration();
+int CLM_LoadCalibration();
+void CLM_SetHDR(const clm_Exposure *exposures, int count, int average);
+int CLM_HDRPoll(clm_Sensor *sensor, unsigned int *channels);
+void CLM_NormalizeChannels(unsigned int *channels, unsigned int *colors);
+int CLM_RestoreConfig(clm_Sensor *sensor);
+int CLM_SetIntegrationTime(clm_Sensor *sensor, unsigned char atime);
+
+/* private functions */
+unsigned int CLM_GetPeriod(clm_Sensor *sensor);
+int CLM_ReadCalibration(int copy, clm_CalibrationBlock *block);
+unsigned char CLM_GainToControl(int gain);
+void CLM_UpdateScale(clm_Sensor *sensor, unsigned char atime, unsigned char control);
+int CLM_WriteRegisters(clm_Sensor *sensor, unsigned char reg, const unsigned char *values, int len);
+int CLM_ReadRegisters(clm_Sensor *sensor, unsigned char reg, unsigned char *values, int len);
+unsigned char CLM_ReadRegister(clm_Sensor *sensor, unsigned char reg);
+int CLM_UpdateRegisters(clm_Sensor *sensor, unsigned char reg, const unsigned char *values, int len);
+int CLM_UpdateRegister(clm_Sensor *sensor, unsigned char reg, unsigned char value);
+int CLM_ShadowIs(clm_Sensor *sensor, unsigned char reg, unsigned char value);
+void CLM_ShadowStore(clm_Sensor *sensor, unsigned char reg, unsigned char value);
+int CLM_Transfer(clm_Sensor *sensor, const unsigned char *writeData, int writeLen, unsigned char *readData, int readLen);
+void CLM_SetTransaction(i2c_Transaction *transaction, unsigned char address, const unsigned char *writeData, int writeLen, unsigned char *readData, int readLen);
+int CLM_I2CGetColorData(clm_Sensor *sensor, unsigned char *colors);
+int CLM_SetExposure(clm_Sensor *sensor, unsigned char atime, unsigned char control);
+void CLM_HDRReset(clm_Sensor *sensor);
+int CLM_HDRPredict(clm_Sensor *sensor);
 
 #endif	/* COLORIMETER_H */
 
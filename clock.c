@@ -0,0 +1,96 @@
+#include "clock.h"
+#include "audio.h"
+#include "gpio.h"
+#include "i2c.h"
+#include "spiflash.h"
+#include "timer.h"
+#include "uart.h"
+#include <p32xxxx.h>
+
+const unsigned char clockPbdiv[clock_PROFILES] = {3, 1, 0}; // OSCCON.PBDIV: divide by 1 << PBDIV
+
+unsigned int clockPB = PB_CLK; // current peripheral bus clock (Hz)
+int clockProfile = CLOCK_BOOT_PROFILE;
+
+/***	CLOCK_GetPB
+**
+**	Parameters:
+**
+**	Return Value:
+**      unsigned int - Current peripheral bus clock (Hz).
+**
+**	Description:
+**		This function returns the clock the drivers have to use for their divisors.
+**      
+**          
+*/
+unsigned int CLOCK_GetPB() {
+    return clockPB;
+}
+
+/***	CLOCK_GetProfile
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - Current clock_PROFILE_x.
+**
+**	Description:
+**		This function returns the active clock profile.
+**      
+**          
+*/
+int CLOCK_GetProfile() {
+    return clockProfile;
+}
+
+/***	CLOCK_SetProfile
+**
+**	Parameters:
+**      int profile - clock_PROFILE_x.
+**
+**	Return Value:
+**      int - clock_OK, clock_ERR_BUSY or clock_ERR_BAUD.
+**
+**	Description:
+**		This function switches the peripheral bus clock. It waits for the UART transmitter to be
+**      empty and refuses while an I2C transaction is running, then changes PBDIV and reapplies all
+**      the divisors with the interrupts disabled, so no driver ever runs with a stale divisor.
+**      Calling it with the active profile costs nothing.
+**      
+**          
+*/
+int CLOCK_SetProfile(int profile) {
+    unsigned int pb = SYS_CLK >> clockPbdiv[profile];
+    
+    if (profile == clockProfile)
+        return clock_OK;
+    if (UART_BaudError(pb) > CLOCK_MAX_BAUD_ERROR)
+        return clock_ERR_BAUD;
+    if (!I2C_IsIdle())
+        return clock_ERR_BUSY;
+    
+    UART_Flush();
+    unsigned int status = __builtin_disable_interrupts();
+    
+    // OSCCON is protected: unlock sequence
+    SYSKEY = 0;
+    SYSKEY = 0xAA996655;
+    SYSKEY = 0x556699AA;
+    OSCCONbits.PBDIV = clockPbdiv[profile];
+    SYSKEY = 0;
+    
+    clockPB = pb;
+    clockProfile = profile;
+    
+    TIMER2_ClockChanged(); // First: the LED duty cycles depend on PR2
+    UART_ClockChanged();
+    I2C_ClockChanged();
+    SPIFLASH_ClockChanged();
+    AUDIO_ClockChanged();
+    RGB_ClockChanged();
+    
+    if (status & 0x01) // Interrupts were enabled
+        __builtin_enable_interrupts();
+    return clock_OK;
+}
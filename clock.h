@@ -0,0 +1,38 @@
+/*
+ * File:   clock.h
+ * @brief Header file for the clock service.
+ *
+ * This file contains the definitions and function prototypes for switching the peripheral bus clock
+ * at runtime and reapplying the divisors of all the drivers.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef CLOCK_H
+#define	CLOCK_H
+
+#include "config.h"
+
+/*
+ * Clock profiles: only the peripheral bus divider (OSCCON.PBDIV) changes, SYS_CLK and so the core timer
+ * stay the same. PB_CLK is the boot clock (FPBDIV); the drivers compute their divisors from CLOCK_GetPB
+ * and CLOCK_SetProfile calls their ClockChanged functions with the interrupts disabled.
+ */
+#define clock_PROFILE_LOW 0 // SYS_CLK / 8 (10 MHz): menu, waiting for the user
+#define clock_PROFILE_NORMAL 1 // SYS_CLK / 2 (40 MHz): scan, log dump and search (SPI flash at its fastest SCK)
+#define clock_PROFILE_FULL 2 // SYS_CLK (80 MHz): boot clock with PB_DIV = 1
+#define clock_PROFILES 3
+#define CLOCK_BOOT_PROFILE (PB_DIV == 1 ? clock_PROFILE_FULL : clock_PROFILE_NORMAL)
+
+#define CLOCK_MAX_BAUD_ERROR 20 // per mille, a profile is refused if the UART baud rate cannot be kept
+
+#define clock_OK 0
+#define clock_ERR_BUSY -1 // I2C transaction running, try again
+#define clock_ERR_BAUD -2 // the baud rate cannot be generated with this clock
+
+/* public functions */
+unsigned int CLOCK_GetPB();
+int CLOCK_GetProfile();
+int CLOCK_SetProfile(int profile);
+
+#endif	/* CLOCK_H */
@@ -10,10 +10,20 @@
 #ifndef CONFIG_H
 #define	CONFIG_H
 
-#define PB_CLK 40000000
+#define SYS_CLK 80000000
+#define PB_DIV 2 // peripheral bus divider (FPBDIV), 1 or 2
+#define PB_CLK (SYS_CLK / PB_DIV)
 
-#define SPIFLASH_PROG_SIZE  2
-#define SPIFLASH_PROG_ADDR  0x100
+#define CLM_MUX_ENABLED 0 // 1: sensors behind a TCA9548A multiplexer
+#define CLM_SENSOR_COUNT 1 // sensors on mux channels 0..CLM_SENSOR_COUNT-1
+
+#define SPIFLASH_SECTOR_SIZE 0x1000 // 4KB erase unit
+#define SPIFLASH_CAL_ADDR   0x1000 // colorimeter calibration (sectors 1 and 2)
+#define SPIFLASH_COUNTER_ADDR 0x3000 // red counter (sectors 3 and 4)
+#define SPIFLASH_SETTINGS_ADDR 0x5000 // settings store (sectors 5 and 6)
+#define SPIFLASH_PCM_ADDR   0x7000 // PCM clip played by function 13 (sectors 7 to 15)
+#define SPIFLASH_LOG_ADDR   0x10000 // sample log, up to the end of the device
+#define SPIFLASH_LOG_END    0x400000 // 32 Mbit device
 
 #define macro_enable_interrupts() {\
     unsigned int val = 0;\
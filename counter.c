@@ -0,0 +1,195 @@
+#include <stddef.h>
+#include <string.h>
+#include "counter.h"
+#include "spiflash.h"
+
+/***	COUNTER_Init
+**
+**	Parameters:
+**      counter_Counter *counter - Counter handle.
+**      unsigned int addr - Address of the first of the two sectors of the counter.
+**
+**	Return Value:
+**
+**	Description:
+**		This function loads the counter from the flash: the sector with the valid header and
+**      the highest base is the active one. If no header is valid the counter is reset to 0.
+**      It must be called after SPIFLASH_Init.
+**      
+**          
+*/
+void COUNTER_Init(counter_Counter *counter, unsigned int addr) {
+    counter_Header header[2];
+    int valid[2];
+    
+    counter->addr = addr;
+    for (int i = 0; i < 2; i++)
+        valid[i] = COUNTER_ReadHeader(addr + i * SPIFLASH_SECTOR_SIZE, &header[i]) == 0;
+    
+    if (!valid[0] && !valid[1]) {
+        COUNTER_Reset(counter);
+        return;
+    }
+    
+    // A reset during the switch leaves both headers valid: the new sector has the highest base
+    counter->sector = !valid[0] || (valid[1] && header[1].base > header[0].base);
+    counter->base = header[counter->sector].base;
+    counter->used = COUNTER_CountBits(addr + counter->sector * SPIFLASH_SECTOR_SIZE);
+}
+
+/***	COUNTER_Increment
+**
+**	Parameters:
+**      counter_Counter *counter - Counter handle.
+**
+**	Return Value:
+**      int - 0 if the new value is stored, -1 if the flash write failed.
+**
+**	Description:
+**		This function increments the counter by clearing one bit of the bitmap: a single byte
+**      program, verified, so every event is stored as soon as it happens. A sector is erased
+**      only once every counter_BITS increments, or when a write fails: the value is then
+**      moved to the other sector.
+**      
+**          
+*/
+int COUNTER_Increment(counter_Counter *counter) {
+    if (counter->used == counter_BITS && COUNTER_Activate(counter, !counter->sector, counter->base + counter->used))
+        return -1;
+    
+    unsigned int addr = counter->addr + counter->sector * SPIFLASH_SECTOR_SIZE + counter_BITMAP + counter->used / 8;
+    unsigned char value = 0xFF << (counter->used % 8 + 1); // Bits 0..used % 8 cleared
+    
+    counter->used++;
+    if (SPIFLASH_ProgramVerify(addr, &value, 1) == SPIFLASH_OK)
+        return 0;
+    
+    return COUNTER_Activate(counter, !counter->sector, counter->base + counter->used);
+}
+
+/***	COUNTER_Get
+**
+**	Parameters:
+**      counter_Counter *counter - Counter handle.
+**
+**	Return Value:
+**      unsigned int - Counter value.
+**
+**	Description:
+**		This function returns the value of the counter (no flash access).
+**      
+**          
+*/
+unsigned int COUNTER_Get(counter_Counter *counter) {
+    return counter->base + counter->used;
+}
+
+/***	COUNTER_Reset
+**
+**	Parameters:
+**      counter_Counter *counter - Counter handle.
+**
+**	Return Value:
+**      int - 0 if done, -1 if the flash write failed.
+**
+**	Description:
+**		This function sets the counter to 0, erasing both its sectors.
+**      
+**          
+*/
+int COUNTER_Reset(counter_Counter *counter) {
+    SPIFLASH_EraseSector(counter->addr + SPIFLASH_SECTOR_SIZE);
+    return COUNTER_Activate(counter, 0, 0);
+}
+
+/***	COUNTER_ReadHeader
+**
+**	Parameters:
+**      unsigned int addr - Sector address.
+**      counter_Header *header - Header read from the flash.
+**
+**	Return Value:
+**      int - 0 if the header is valid, -1 otherwise.
+**
+**	Description:
+**		This function reads the header of a counter sector and checks its magic and CRC.
+**      
+**          
+*/
+int COUNTER_ReadHeader(unsigned int addr, counter_Header *header) {
+    SPIFLASH_Read(addr, (unsigned char *) header, sizeof(counter_Header));
+    
+    if (header->magic != counter_MAGIC ||
+            header->crc != SPIFLASH_CRC16(0xFFFF, (unsigned char *) header, offsetof(counter_Header, crc)))
+        return -1;
+    return 0;
+}
+
+/***	COUNTER_Activate
+**
+**	Parameters:
+**      counter_Counter *counter - Counter handle.
+**      int sector - Sector to be activated (0 or 1).
+**      unsigned int base - Value of the counter.
+**
+**	Return Value:
+**      int - 0 if the header is written, -1 otherwise (the value is kept in RAM).
+**
+**	Description:
+**		This function erases a sector and writes its header. The old sector is left as it is
+**      (its base is lower) and is erased only when it is activated again.
+**      
+**          
+*/
+int COUNTER_Activate(counter_Counter *counter, int sector, unsigned int base) {
+    unsigned int addr = counter->addr + sector * SPIFLASH_SECTOR_SIZE;
+    counter_Header header;
+    
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = counter_MAGIC;
+    header.base = base;
+    header.crc = SPIFLASH_CRC16(0xFFFF, (unsigned char *) &header, offsetof(counter_Header, crc));
+    
+    SPIFLASH_EraseSector(addr);
+    
+    counter->sector = sector;
+    counter->base = base;
+    counter->used = 0;
+    return SPIFLASH_ProgramVerify(addr, (unsigned char *) &header, sizeof(header)) == SPIFLASH_OK ? 0 : -1;
+}
+
+/***	COUNTER_CountBits
+**
+**	Parameters:
+**      unsigned int addr - Sector address.
+**
+**	Return Value:
+**      unsigned int - Bits cleared in the bitmap.
+**
+**	Description:
+**		This function finds the first bitmap byte not fully cleared with a binary search
+**      (the bits are cleared in order), so only about 12 bytes are read.
+**      
+**          
+*/
+unsigned int COUNTER_CountBits(unsigned int addr) {
+    unsigned int low = 0, high = SPIFLASH_SECTOR_SIZE - counter_BITMAP;
+    unsigned char value;
+    
+    while (low < high) {
+        unsigned int mid = (low + high) / 2;
+        SPIFLASH_Read(addr + counter_BITMAP + mid, &value, 1);
+        if (value == 0x00)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    
+    unsigned int bits = low * 8;
+    if (low < SPIFLASH_SECTOR_SIZE - counter_BITMAP) {
+        SPIFLASH_Read(addr + counter_BITMAP + low, &value, 1);
+        for (; !(value & 1) && bits < counter_BITS; value >>= 1)
+            bits++;
+    }
+    return bits;
+}
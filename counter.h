@@ -0,0 +1,50 @@
+/*
+ * File:   counter.h
+ * @brief Header file for the flash event counter.
+ *
+ * This file contains the definitions and function prototypes for a monotonic counter stored in SPI flash
+ * without erasing at every increment.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef COUNTER_H
+#define	COUNTER_H
+
+#include "config.h"
+
+/*
+ * A counter uses two sectors. The active sector starts with a header holding the base value,
+ * the rest is a bitmap: every increment clears the next bit (least significant first) with a one
+ * byte program, so value = base + cleared bits. When the bitmap is used up the other sector is
+ * erased and becomes active with base = value; the header with the highest base wins at boot.
+ */
+#define counter_MAGIC 0x434E5452 // "CNTR"
+#define counter_BITMAP 12 // bitmap offset in the sector
+#define counter_BITS ((SPIFLASH_SECTOR_SIZE - counter_BITMAP) * 8) // increments per erase
+
+typedef struct {
+    unsigned int magic; // counter_MAGIC
+    unsigned int base; // value when the sector was activated
+    unsigned short crc; // SPIFLASH_CRC16 of the fields above
+} counter_Header;
+
+typedef struct {
+    unsigned int addr; // first of the two sectors
+    int sector; // active sector (0 or 1)
+    unsigned int base; // base of the active sector
+    unsigned int used; // bits cleared in the active sector
+} counter_Counter;
+
+/* public functions */
+void COUNTER_Init(counter_Counter *counter, unsigned int addr);
+int COUNTER_Increment(counter_Counter *counter);
+unsigned int COUNTER_Get(counter_Counter *counter);
+int COUNTER_Reset(counter_Counter *counter);
+
+/* private functions */
+int COUNTER_ReadHeader(unsigned int addr, counter_Header *header);
+int COUNTER_Activate(counter_Counter *counter, int sector, unsigned int base);
+unsigned int COUNTER_CountBits(unsigned int addr);
+
+#endif	/* COUNTER_H */
@@ -3,6 +3,20 @@
 #include "timer.h"
 #include <p32xxxx.h>
 
+volatile unsigned int btncEdgeTime; // time of the last INT4 edge, set by BTNC_Edge
+volatile unsigned char btncEdge = 0; // an edge arrived and the level is not stable yet
+unsigned char btncPressed = 0; // debounced state
+unsigned char btncLongSent = 0; // the long press of this hold has been reported
+unsigned char btncClicks = 0; // short presses waiting for a possible second click
+unsigned int btncPressTime, btncReleaseTime; // debounced transitions
+unsigned int btncEventTime; // press time of the last event
+
+rgb_Group rgbGroups[RGB_MAX_GROUPS]; // pattern being played
+int rgbGroupCount = 0, rgbGroup; // groups of the pattern and current group
+unsigned char rgbBlinks, rgbOn; // blinks left in the current group, LED on in this step
+volatile unsigned int rgbRemaining = 0; // ms left of the current step, 0 when idle
+unsigned char rgbColor[3]; // brightness set by RGB_SetColor, reapplied after a clock change
+
 /***	BTNC_Init
 **
 **	Parameters:
@@ -13,7 +27,8 @@
 **
 **	Description:
 **		This function initializes the button BTNC by configuring the pin as input and setting up the interrupt.
-**      It assigns INT4 to the pin RF0 and configures the interrupt on the falling edge with a specified priority and sub-priority.
+**      It assigns INT4 to the pin RF0 and configures the interrupt on the next edge (opposite to the
+**      current level) with a specified priority and sub-priority.
 **      
 **          
 */
@@ -24,7 +39,7 @@ void BTNC_Init() {
     INT4R = 0b0100; // Assign INT4 to pin RF0 (port F, pin 0)
 
     // Configure interrupt
-    INTCONbits.INT4EP = 0; // Configure interrupt on falling edge
+    INTCONbits.INT4EP = !prt_BTN_BTNC; // Configure interrupt on the next edge (1 rising, 0 falling)
     IPC4bits.INT4IP = 7;   // Set interrupt priority for INT4
     IPC4bits.INT4IS = 3;   // Set interrupt sub-priority for INT4
     
@@ -34,6 +49,101 @@ void BTNC_Init() {
     IEC0bits.INT4IE = 1;   // Enable interrupt for INT4
 }
 
+/***	BTNC_Edge
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function has to be called by the INT4 interrupt: it timestamps the edge and arms
+**      the interrupt for the opposite one. No decision is taken here.
+**      
+**          
+*/
+void BTNC_Edge() {
+    btncEdgeTime = TIMER_GetMS();
+    btncEdge = 1;
+    INTCONbits.INT4EP = !prt_BTN_BTNC;
+}
+
+/***	BTNC_GetEvent
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**      int - btnc_EVENT_x, btnc_EVENT_NONE if nothing happened.
+**
+**	Description:
+**		This function has to be called by the main loop. It debounces the edges against the system
+**      tick and turns the press and release times into gestures: a press held for BTNC_LONG_MS is
+**      a long press, two short presses within BTNC_DOUBLE_MS a double click, otherwise a short press
+**      (reported BTNC_DOUBLE_MS after the release).
+**      
+**          
+*/
+int BTNC_GetEvent() {
+    unsigned int now = TIMER_GetMS();
+    
+    if (btncEdge && now - btncEdgeTime >= BTNC_DEBOUNCE_MS) {
+        unsigned int edgeTime = btncEdgeTime;
+        btncEdge = 0;
+        if (btncEdgeTime != edgeTime)
+            btncEdge = 1; // A new bounce arrived meanwhile: wait again
+        
+        unsigned char pressed = prt_BTN_BTNC == BTNC_PRESSED;
+        if (!btncEdge)
+            INTCONbits.INT4EP = !prt_BTN_BTNC; // Armed again on the stable level, in case a fast bounce was missed
+        if (!btncEdge && pressed != btncPressed) {
+            btncPressed = pressed;
+            if (pressed) {
+                btncPressTime = edgeTime;
+                btncLongSent = 0;
+            } else if (!btncLongSent) {
+                btncReleaseTime = edgeTime;
+                if (++btncClicks == 2) {
+                    btncClicks = 0;
+                    return btnc_EVENT_DOUBLE;
+                }
+                btncEventTime = btncPressTime;
+            }
+        }
+    }
+    
+    if (btncPressed && !btncLongSent && now - btncPressTime >= BTNC_LONG_MS) {
+        btncLongSent = 1;
+        btncClicks = 0;
+        btncEventTime = btncPressTime;
+        return btnc_EVENT_LONG;
+    }
+    
+    if (btncClicks && !btncPressed && !btncEdge && now - btncReleaseTime >= BTNC_DOUBLE_MS) {
+        btncClicks = 0;
+        return btnc_EVENT_SHORT;
+    }
+    return btnc_EVENT_NONE;
+}
+
+/***	BTNC_GetEventTime
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**      unsigned int - System time (ms) of the press that started the last event.
+**
+**	Description:
+**		This function timestamps the gestures: a short press is reported late, its time is the press.
+**      
+**          
+*/
+unsigned int BTNC_GetEventTime() {
+    return btncEventTime;
+}
+
 /***	RGB_Init
 **
 **	Parameters:
@@ -43,7 +153,8 @@ void BTNC_Init() {
 **		
 **
 **	Description:
-**		This function initializes the RGB LED by configuring the pins and setting the initial state to off.
+**		This function initializes the RGB LED by configuring the pins and the PWM outputs, with the LED off.
+**      Timer2 has to be running already (TIMER2_Init).
 **      
 **          
 */
@@ -53,6 +164,8 @@ void RGB_Init() {
     lat_RGB_R = 0;
     lat_RGB_G = 0;
     lat_RGB_B = 0;
+    
+    RGB_ConfigureOC();
 }
 
 /***	RGB_ConfigurePin
@@ -79,6 +192,135 @@ void RGB_ConfigurePin() {
     ANSELDbits.ANSD3 = 0;
 }
 
+/***	RGB_ConfigureOC
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function maps OC3, OC5 and OC4 to the red, green and blue pins and sets them in PWM mode
+**      on Timer2, the 1 ms system tick: the brightness costs no interrupt and no CPU time.
+**      
+**          
+*/
+void RGB_ConfigureOC() {
+    rp_RGB_R = RGB_PPS_OC; // OC3
+    rp_RGB_G = RGB_PPS_OC; // OC5
+    rp_RGB_B = RGB_PPS_OC; // OC4
+    
+    OC3CONbits.ON = 0;
+    OC3CONbits.OCM = 6; // PWM mode, fault pin disabled
+    OC3CONbits.OCTSEL = 0; // Timer2
+    OC3RS = 0;
+    OC3R = 0;
+    
+    OC4CONbits.ON = 0;
+    OC4CONbits.OCM = 6;
+    OC4CONbits.OCTSEL = 0;
+    OC4RS = 0;
+    OC4R = 0;
+    
+    OC5CONbits.ON = 0;
+    OC5CONbits.OCM = 6;
+    OC5CONbits.OCTSEL = 0;
+    OC5RS = 0;
+    OC5R = 0;
+    
+    OC3CONbits.ON = 1;
+    OC4CONbits.ON = 1;
+    OC5CONbits.ON = 1;
+}
+
+/***	RGB_SetColor
+**
+**	Parameters:
+**      unsigned char r - Red brightness (0..255).
+**      unsigned char g - Green brightness (0..255).
+**      unsigned char b - Blue brightness (0..255).
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function sets the brightness of each channel. The values are gamma corrected, so equal
+**      steps look equal, and are loaded by the OC modules at the end of the current PWM period.
+**      
+**          
+*/
+void RGB_SetColor(unsigned char r, unsigned char g, unsigned char b) {
+    rgbColor[0] = r;
+    rgbColor[1] = g;
+    rgbColor[2] = b;
+    OC3RS = RGB_Gamma(r);
+    OC5RS = RGB_Gamma(g);
+    OC4RS = RGB_Gamma(b);
+}
+
+/***	RGB_ClockChanged
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function reapplies the current colour after TIMER2_ClockChanged, since the duty cycles
+**      are in Timer2 counts and the period changes with the peripheral bus clock.
+**      
+**          
+*/
+void RGB_ClockChanged() {
+    RGB_SetColor(rgbColor[0], rgbColor[1], rgbColor[2]);
+}
+
+/***	RGB_ShowColor
+**
+**	Parameters:
+**      unsigned int r, g, b - Measured colour channels (any scale).
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function shows a measured colour: the channels are scaled so that the largest one is at
+**      full brightness, so the LED shows the hue and saturation of the sample. Black turns the LED off.
+**      
+**          
+*/
+void RGB_ShowColor(unsigned int r, unsigned int g, unsigned int b) {
+    unsigned int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    
+    if (max == 0) {
+        RGB_SetColor(0, 0, 0);
+        return;
+    }
+    RGB_SetColor(r * 255 / max, g * 255 / max, b * 255 / max);
+}
+
+/***	RGB_Gamma
+**
+**	Parameters:
+**      unsigned char value - Brightness (0..255).
+**
+**	Return Value:
+**      unsigned int - Duty cycle in Timer2 counts (0..RGB_PWM_STEPS).
+**
+**	Description:
+**		This function applies a gamma of 2 (square law), close to the 2.2 of the eye and computed
+**      with integers only. The result is rounded and any value above 0 gets at least one count,
+**      so the dimmest levels do not turn the LED off (with 625 counts 1..7 would round to 0).
+**      
+**          
+*/
+unsigned int RGB_Gamma(unsigned char value) {
+    unsigned int duty = ((unsigned int) value * value * RGB_PWM_STEPS + 255 * 255 / 2) / (255 * 255);
+    return value && !duty ? 1 : duty;
+}
+
 /***	RGB_SetValue
 **
 **	Parameters:
@@ -90,35 +332,186 @@ void RGB_ConfigurePin() {
 **		
 **
 **	Description:
-**		This function sets the RGB LED to the specified values for red, green, and blue.
+**		This function switches each channel of the RGB LED fully on or off.
 **      
 **          
 */
 void RGB_SetValue(char r, char g, char b) {
-    lat_RGB_R = r;
-    lat_RGB_G = g;
-    lat_RGB_B = b;
+    RGB_SetColor(r ? 255 : 0, g ? 255 : 0, b ? 255 : 0);
+}
+
+/***	RGB_ShowCount
+**
+**	Parameters:
+**      unsigned int count - Value to be shown.
+**      unsigned char r, g, b - Colour of the blinks.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function shows a count and returns at once: up to RGB_PLAIN_MAX as plain blinks,
+**      above one decimal digit at a time, so 200 takes a few seconds instead of 100.
+**      
+**          
+*/
+void RGB_ShowCount(unsigned int count, unsigned char r, unsigned char g, unsigned char b) {
+    unsigned char digits[RGB_MAX_GROUPS];
+    int n = 0;
+    
+    RGB_Stop();
+    if (count > 0 && count <= RGB_PLAIN_MAX) {
+        RGB_SetGroup(&rgbGroups[0], count, r, g, b);
+        RGB_Play(1);
+        return;
+    }
+    
+    do {
+        digits[n++] = count % 10;
+        count /= 10;
+    } while (count);
+    
+    for (int i = 0; i < n; i++) { // Most significant digit first
+        rgb_Group *group = &rgbGroups[i];
+        if (digits[n - 1 - i]) {
+            RGB_SetGroup(group, digits[n - 1 - i], r, g, b);
+        } else {
+            RGB_SetGroup(group, 1, 0, 0, 255);
+            group->onMs = RGB_ZERO_MS;
+        }
+        group->gapMs = RGB_DIGIT_GAP_MS;
+    }
+    RGB_Play(n);
+}
+
+/***	RGB_Stop
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function cancels the pattern being played and turns the LED off.
+**      
+**          
+*/
+void RGB_Stop() {
+    IEC0CLR = _IEC0_T2IE_MASK; // RGB_Tick is not called while the pattern is changed
+    if (rgbRemaining)
+        RGB_SetColor(0, 0, 0);
+    rgbRemaining = 0;
+    rgbGroupCount = 0;
+    IEC0SET = _IEC0_T2IE_MASK;
 }
 
-/***	RED_Pulse
+/***	RGB_Tick
 **
 **	Parameters:
-**      int times - Number of times to pulse the red LED.
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function has to be called every millisecond (Timer2 interrupt). When the current
+**      step of the pattern ends it moves to the next one.
+**      
+**          
+*/
+void RGB_Tick() {
+    if (rgbRemaining == 0 || --rgbRemaining > 0)
+        return;
+    RGB_NextStep();
+}
+
+/***	RGB_SetGroup
+**
+**	Parameters:
+**      rgb_Group *group - Group to be set.
+**      unsigned int count - Number of blinks.
+**      unsigned char r, g, b - Colour.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function sets a group with the count blink timing and no pause after it.
+**      
+**          
+*/
+void RGB_SetGroup(rgb_Group *group, unsigned int count, unsigned char r, unsigned char g, unsigned char b) {
+    group->count = count;
+    group->r = r;
+    group->g = g;
+    group->b = b;
+    group->onMs = RGB_BLINK_MS;
+    group->offMs = RGB_BLINK_MS;
+    group->gapMs = 0;
+}
+
+/***	RGB_Play
+**
+**	Parameters:
+**      int groups - Number of groups set in rgbGroups.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function starts the pattern with its first step (called with RGB_Tick stopped by RGB_Stop
+**      or from RGB_Tick itself, so the state is never changed by both).
+**      
+**          
+*/
+void RGB_Play(int groups) {
+    IEC0CLR = _IEC0_T2IE_MASK;
+    rgbGroupCount = groups;
+    rgbGroup = 0;
+    rgbBlinks = rgbGroups[0].count;
+    rgbOn = 0;
+    RGB_NextStep();
+    IEC0SET = _IEC0_T2IE_MASK;
+}
+
+/***	RGB_NextStep
+**
+**	Parameters:
+**		
 **
 **	Return Value:
 **		
 **
 **	Description:
-**		This function pulses the red LED on and off for the specified number of times.
-**      Each pulse consists of turning the LED on for 250 milliseconds and then off for 250 milliseconds.
+**		This function moves the pattern one step forward: LED on for onMs, then off for offMs between
+**      the blinks of a group or for gapMs after its last blink. rgbRemaining is 0 at the end.
 **      
 **          
 */
-void RED_Pulse(int times) {
-    for (int i = 0; i < times; i++) {
-        TIMER2_DelayMS(250);
-        RGB_SetValue(1, 0, 0);
-        TIMER2_DelayMS(250);
-        RGB_SetValue(0, 0, 0);
+void RGB_NextStep() {
+    while (rgbGroup < rgbGroupCount) {
+        rgb_Group *group = &rgbGroups[rgbGroup];
+        unsigned int ms;
+        
+        if (rgbOn) {
+            RGB_SetColor(0, 0, 0);
+            rgbOn = 0;
+            ms = --rgbBlinks ? group->offMs : group->gapMs;
+        } else if (rgbBlinks) {
+            RGB_SetColor(group->r, group->g, group->b);
+            rgbOn = 1;
+            ms = group->onMs;
+        } else {
+            ms = 0;
+        }
+        
+        if (!rgbBlinks && !rgbOn && ++rgbGroup < rgbGroupCount)
+            rgbBlinks = rgbGroups[rgbGroup].count; // Group done
+        if (ms) {
+            rgbRemaining = ms;
+            return;
+        }
     }
+    rgbRemaining = 0; // Pattern ended, the LED is off
 }
@@ -15,6 +15,21 @@
 
 #define prt_BTN_BTNC PORTFbits.RF0
 
+/*
+ * BTNC gestures: INT4 alternates its edge to see both press and release, the ISR only timestamps
+ * the edge. BTNC_GetEvent accepts a level once it has been stable for BTNC_DEBOUNCE_MS, so the
+ * bounces of a press give a single transition.
+ */
+#define BTNC_PRESSED 1 // RF0 level when pressed
+#define BTNC_DEBOUNCE_MS 20
+#define BTNC_LONG_MS 800 // long press, reported while still held
+#define BTNC_DOUBLE_MS 300 // max release -> press gap of a double click (delays the short press)
+
+#define btnc_EVENT_NONE 0
+#define btnc_EVENT_SHORT 1
+#define btnc_EVENT_LONG 2
+#define btnc_EVENT_DOUBLE 3
+
 /* RBGLed Pins */
 #define tris_RGB_R TRISDbits.TRISD2
 #define tris_RGB_G TRISDbits.TRISD12
@@ -24,13 +39,52 @@
 #define lat_RGB_G LATDbits.LATD12
 #define lat_RGB_B LATDbits.LATD3
 
+/* RGB LED PWM: OC3 (red), OC5 (green) and OC4 (blue) on the Timer2 period (1 ms, PR2 + 1 steps) */
+#define rp_RGB_R RPD2R
+#define rp_RGB_G RPD12R
+#define rp_RGB_B RPD3R
+#define RGB_PPS_OC 0x0B // OC3, OC4 and OC5 have the same code on these pins
+#define RGB_PWM_STEPS (PR2 + 1) // Timer2 period in counts, depends on the clock profile
+
+/*
+ * LED patterns, played by RGB_Tick (1 ms Timer2 interrupt): a pattern is a list of groups of blinks.
+ * Counts up to RGB_PLAIN_MAX are shown as plain blinks, larger counts one decimal digit per group
+ * (digit d = d short blinks, 0 = one long blue blink) with a pause between digits.
+ */
+#define RGB_MAX_GROUPS 10 // decimal digits of an unsigned int
+#define RGB_PLAIN_MAX 9
+#define RGB_BLINK_MS 250 // on and off time of a count blink
+#define RGB_ZERO_MS 600 // on time of a zero digit
+#define RGB_DIGIT_GAP_MS 1000 // pause after each digit
+
+typedef struct {
+    unsigned char count; // blinks
+    unsigned char r, g, b; // colour
+    unsigned short onMs, offMs; // blink timing
+    unsigned short gapMs; // pause after the group
+} rgb_Group;
+
 /* public functions */
 void BTNC_Init();
+void BTNC_Edge();
+int BTNC_GetEvent();
+unsigned int BTNC_GetEventTime();
+void RGB_Init();
+void RGB_SetColor(unsigned char r, unsigned char g, unsigned char b);
+void RGB_ShowColor(unsigned int r, unsigned int g, unsigned int b);
+void RGB_ShowCount(unsigned int count, unsigned char r, unsigned char g, unsigned char b);
+void RGB_Stop();
+void RGB_Tick();
+void RGB_ClockChanged();
 
 /* private functions */
 void RGB_ConfigurePin();
+void RGB_ConfigureOC();
+unsigned int RGB_Gamma(unsigned char value);
 void RGB_SetValue(char r, char g, char b);
-void RED_Pulse(int times);
+void RGB_SetGroup(rgb_Group *group, unsigned int count, unsigned char r, unsigned char g, unsigned char b);
+void RGB_Play(int groups);
+void RGB_NextStep();
 
 #endif	/* RGBLED_H */
 
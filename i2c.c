@@ -1,22 +1,77 @@
+#include "clock.h"
 #include "config.h"
 #include "i2c.h"
+#include "timer.h"
 #include <p32xxxx.h>
 
+unsigned int i2cFrequency = 0; // Actual bus frequency (Hz)
+unsigned int i2cRequested = 0; // Frequency requested to I2C_Init (Hz), used by I2C_Recover
+
+/* transaction engine */
+i2c_Transaction *i2cQueue[I2C_QUEUE_SIZE]; // pending transactions, i2cQueue[i2cHead] is running
+volatile unsigned char i2cHead = 0, i2cTail = 0;
+i2c_Transaction *i2cDone[I2C_QUEUE_SIZE]; // completed transactions waiting for their callback
+volatile unsigned char i2cDoneHead = 0, i2cDoneTail = 0;
+volatile unsigned char i2cState = i2c_STATE_IDLE;
+volatile unsigned int i2cPhaseStart; // core timer value when the current phase started
+int i2cIndex; // byte index inside the current write or read phase
+int i2cError; // result of the running transaction, reported after its stop condition
+
 /***	I2C_Init
 **
 **	Parameters:
 **		unsigned int i2cFreq - I2C clock frequency (Hz).
 **          for example 400000 value sent as parameter corresponds to 400 kHz
+**          i2c_FREQ_100K, i2c_FREQ_400K and i2c_FREQ_1M are supported.
 **
 **	Return Value:
+**      unsigned int - The bus frequency actually obtained (Hz), 0 if i2cFreq cannot be generated.
 **
 **	Description:
 **		This function configures the I2C1 hardware interface of PIC32, according to the provided frequency.
-**      In order to compute the baud rate value, it uses the peripheral bus frequency definition (PB_FRQ, located in config.h).
+**      In order to compute the baud rate value, it uses the current peripheral bus frequency (CLOCK_GetPB).
+**      BRG = PB_CLK / (2 * Fsck) - PB_CLK * TPGD - 2, computed with integer math and rounded to the nearest value.
+**      Slew rate control is enabled only in Fast mode, as required by the I2C specification.
+**      The I2C1 interrupts are enabled for the transaction engine (see I2C_MasterEvent).
 **      This is a low-level function called by ACL_Init(), so user should avoid calling it directly.
 **          
 */
-void I2C_Init(unsigned int i2cFreq) {
+unsigned int I2C_Init(unsigned int i2cFreq) {
+    unsigned int freq = I2C_Setup(i2cFreq);
+    
+    if (freq) {
+        IEC1SET = _IEC1_I2C1MIE_MASK;
+        IEC0SET = _IEC0_I2C1BIE_MASK;
+    }
+    return freq;
+}
+
+/***	I2C_Setup
+**
+**	Parameters:
+**		unsigned int i2cFreq - I2C clock frequency (Hz).
+**
+**	Return Value:
+**      unsigned int - The bus frequency actually obtained (Hz), 0 if i2cFreq cannot be generated.
+**
+**	Description:
+**		This function programs I2C1 and the priority of its interrupts, as described in I2C_Init,
+**      without touching the interrupt enables: I2C_Recover runs with the engine masked and
+**      its caller enables the interrupts again once the queue is consistent.
+**          
+*/
+unsigned int I2C_Setup(unsigned int i2cFreq) {
+    unsigned int pb = CLOCK_GetPB();
+    
+    if (i2cFreq == 0)
+        return 0;
+    
+    int tpgd = ((pb / 1000) * I2C_TPGD_NS + 500000) / 1000000; // TPGD in PB clock cycles
+    int brg = (pb + i2cFreq) / (2 * i2cFreq) - tpgd - 2;
+    
+    if (brg < 2) // BRG values 0 and 1 are not allowed
+        return 0;
+    
     // no need pin mapping
     // SCL1 pin setup
     TRISGbits.TRISG2 = 0; // as digital output
@@ -24,121 +79,455 @@ void I2C_Init(unsigned int i2cFreq) {
     // SDA1 pin setup
     TRISGbits.TRISG3 = 0; // as digital output
     
+    i2cRequested = i2cFreq;
+    
     I2C1CON = 0x0000;            //Clear the content of I2C1CON register 
-    I2C1BRG = ((1 / (2 * i2cFreq) - I2C_TPGD) * PB_CLK) - 2;
+    I2C1BRG = brg;
+    I2C1CONbits.DISSLW = i2cFreq != i2c_FREQ_400K; // Slew rate control only for 400kHz
     I2C1CONbits.ON = 1;     // Enable the I2C module
+    
+    // Master and bus collision events drive the transaction engine
+    IPC6bits.I2C1IP = I2C_INT_PRIORITY;
+    IPC6bits.I2C1IS = 0;
+    IFS1CLR = _IFS1_I2C1MIF_MASK;
+    IFS0CLR = _IFS0_I2C1BIF_MASK;
+    
+    // Fsck = 1 / (2 * ((BRG + 2) / PB_CLK + TPGD))
+    i2cFrequency = 1000000000u / (2 * ((brg + 2) * 1000 / (pb / 1000000) + I2C_TPGD_NS));
+    return i2cFrequency;
 }
 
-/***	I2C_MasterStart
+/***	I2C_ClockChanged
 **
 **	Parameters:
 **
 **	Return Value:
 **
 **	Description:
-**		This function sends the start bit to initiate communication on the I2C bus.
-**      It waits until the start bit is sent before returning.
+**		This function reconfigures the bus for the new peripheral bus clock, at the frequency requested
+**      to I2C_Init. If that frequency cannot be generated any more, the bus falls back to 400 kHz.
+**      Called by CLOCK_SetProfile only when I2C_IsIdle.
+**          
+*/
+void I2C_ClockChanged() {
+    if (i2cRequested && !I2C_Init(i2cRequested))
+        I2C_Init(i2c_FREQ_400K);
+}
+
+/***	I2C_IsIdle
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - 1 if no transaction is running or queued, 0 otherwise.
+**
+**	Description:
+**		This function tells whether the bus can be reconfigured.
+**          
+*/
+int I2C_IsIdle() {
+    return i2cState == i2c_STATE_IDLE && i2cHead == i2cTail;
+}
+
+/***	I2C_GetFrequency
+**
+**	Parameters:
+**
+**	Return Value:
+**      unsigned int - The bus frequency (Hz) obtained by the last I2C_Init.
+**
+**	Description:
+**		This function returns the actual I2C bus frequency.
+**          
+*/
+unsigned int I2C_GetFrequency() {
+    return i2cFrequency;
+}
+
+/***	I2C_Recover
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - i2c_OK if the bus is free, i2c_ERR_BUS if SDA is still held low.
+**
+**	Description:
+**		This function releases a bus left in an undefined state (for example a slave holding SDA
+**      low in the middle of a byte). The I2C1 module is switched off and SCL is clocked by hand,
+**      in open drain mode, up to I2C_RECOVERY_CLOCKS times until the slave releases SDA.
+**      Then a stop condition is generated and I2C1 is set up again with the last frequency.
+**      It takes about 100 us at 100 kHz timing, so it is never run from the I2C interrupt.
+**      The interrupt enables are not changed: the caller masks the engine and enables it again.
 **      
 **          
 */
-void I2C_MasterStart() {
-    I2C1CONbits.SEN = 1; // send the start bit
-    while(I2C1CONbits.SEN); // wait for the start bit to be sent
+int I2C_Recover() {
+    I2C1CONbits.ON = 0; // give the pins back to the port logic
+    
+    // Open drain emulation: LAT = 0, TRIS = 1 releases the line, TRIS = 0 pulls it low
+    LATGbits.LATG2 = 0;
+    LATGbits.LATG3 = 0;
+    TRISGbits.TRISG2 = 1;
+    TRISGbits.TRISG3 = 1;
+    I2C_DelayUS(5);
+    
+    for (int i = 0; i < I2C_RECOVERY_CLOCKS && !PORTGbits.RG3; i++) {
+        TRISGbits.TRISG2 = 0; // SCL low
+        I2C_DelayUS(5);
+        TRISGbits.TRISG2 = 1; // SCL high
+        I2C_DelayUS(5);
+    }
+    
+    // Stop condition: SDA rises while SCL is high
+    TRISGbits.TRISG2 = 0;
+    TRISGbits.TRISG3 = 0;
+    I2C_DelayUS(5);
+    TRISGbits.TRISG2 = 1;
+    I2C_DelayUS(5);
+    TRISGbits.TRISG3 = 1;
+    I2C_DelayUS(5);
+    
+    int busFree = PORTGbits.RG3;
+    
+    I2C1STATbits.BCL = 0;
+    I2C1STATbits.IWCOL = 0;
+    I2C_Setup(i2cRequested);
+    
+    return busFree ? i2c_OK : i2c_ERR_BUS;
 }
 
-/***	I2C_MasterRestart
+/***	I2C_Expired
 **
 **	Parameters:
+**      unsigned int start - Core timer value at the beginning of the bus phase.
 **
 **	Return Value:
+**      int - 1 if the phase lasted more than I2C_WAIT_TIMEOUT.
 **
 **	Description:
-**		This function sends a restart condition on the I2C bus.
-**      It waits until the restart condition is sent before returning.
+**		This function checks the timeout of a bus phase.
 **      
 **          
 */
-void I2C_MasterRestart() {
-    I2C1CONbits.RSEN = 1; // send a restart
-    while(I2C1CONbits.RSEN) { ; } // wait for the restart to clear
+int I2C_Expired(unsigned int start) {
+    return TIMER_GetCoreTicks() - start > I2C_WAIT_TIMEOUT * CORE_TICKS_PER_US;
 }
 
-/***	I2C_MasterSend
+/***	I2C_DelayUS
 **
 **	Parameters:
-**      unsigned char byte - The byte to be sent to the slave device.
+**      unsigned int us - Delay in microseconds.
 **
 **	Return Value:
 **
 **	Description:
-**		This function sends a byte to the slave device on the I2C bus.
-**      It waits until the transmission is complete before returning.
+**		This function waits the specified time using the core timer (bus recovery timing).
 **      
 **          
 */
-unsigned char I2C_MasterSend(unsigned char byte) {
-    // send a byte to slave
-    I2C1TRN = byte; // if an address, bit 0 = 0 for write, 1 for read
-    while(I2C1STATbits.TRSTAT); // wait for the transmission to finish
-    // if this is high, slave has not acknowledged
-    I2C1STATbits.ACKSTAT;
+void I2C_DelayUS(unsigned int us) {
+    unsigned int start = TIMER_GetCoreTicks();
+    while (TIMER_GetCoreTicks() - start < us * CORE_TICKS_PER_US);
 }
 
-/***	I2C_MasterReceive
+/***	I2C_Submit
 **
 **	Parameters:
+**      i2c_Transaction *transaction - Transaction to be queued, it must stay valid until it completes.
 **
 **	Return Value:
-**      unsigned char - The byte received from the slave device.
+**      int - i2c_OK if queued, i2c_ERR_FULL if there is no room.
 **
 **	Description:
-**		This function receives a byte from the slave device on the I2C bus.
-**      It waits until the data is received before returning.
+**		This function appends a transaction to the queue of the engine and starts it if the bus is idle.
+**      Queued transactions are executed one after another from the I2C interrupt, a new start
+**      condition follows the stop of the previous transaction without any intervention of the main loop.
+**      The callback, if present, is called by I2C_Process once the transaction has completed.
 **      
 **          
 */
-unsigned char I2C_MasterReceive() {
-    // receive a byte from the slave
-    I2C1CONbits.RCEN = 1; // start receiving data
-    while(!I2C1STATbits.RBF) { ; } // wait to receive the data
-    return I2C1RCV; // read and return the data
+int I2C_Submit(i2c_Transaction *transaction) {
+    return I2C_SubmitList(&transaction, 1);
 }
 
-/***	I2C_MasterACK
+/***	I2C_SubmitList
 **
 **	Parameters:
-**      int val - The value to send as an acknowledgment (0 for ACK, 1 for NACK).
+**      i2c_Transaction **transactions - Transactions to be queued in order, they must stay valid until they complete.
+**      int count - Number of transactions.
 **
 **	Return Value:
+**      int - i2c_OK if all of them are queued, i2c_ERR_FULL if there is no room (none is queued).
 **
 **	Description:
-**		This function sends an acknowledgment (ACK) or not-acknowledgment (NACK) to the slave device.
-**      It waits until the acknowledgment is sent before returning.
+**		This function queues a group of transactions atomically, e.g. a multiplexer selection
+**      chained to the access it prepares: either the whole group runs or nothing is sent on the bus.
 **      
 **          
 */
-void I2C_MasterACK(int val) {
-    // sends ACK = 0 (slave should send another byte)
-    // or NACK = 1 (no more bytes requested from slave)
-    I2C1CONbits.ACKDT = val; // store ACK/NACK in ACKDT
-    I2C1CONbits.ACKEN = 1; // send ACKDT
-    while(I2C1CONbits.ACKEN); // wait for ACK/NACK to be sent
+int I2C_SubmitList(i2c_Transaction **transactions, int count) {
+    int err = i2c_OK;
+    int callbacks = 0;
+    
+    for (int i = 0; i < count; i++) {
+        if (transactions[i]->callback)
+            callbacks++;
+    }
+    
+    IEC1CLR = _IEC1_I2C1MIE_MASK; // The engine must not run while the queue is updated
+    IEC0CLR = _IEC0_I2C1BIE_MASK;
+    
+    int used = (i2cTail - i2cHead + I2C_QUEUE_SIZE) % I2C_QUEUE_SIZE;
+    int waiting = (i2cDoneTail - i2cDoneHead + I2C_QUEUE_SIZE) % I2C_QUEUE_SIZE;
+    
+    // One slot stays empty, transactions with a callback also need a place in the completed queue
+    if (used + count > I2C_QUEUE_SIZE - 1 || (callbacks && used + count + waiting > I2C_QUEUE_SIZE - 1)) {
+        err = i2c_ERR_FULL;
+    } else {
+        for (int i = 0; i < count; i++) {
+            transactions[i]->status = i2c_PENDING;
+            i2cQueue[i2cTail] = transactions[i];
+            i2cTail = (i2cTail + 1) % I2C_QUEUE_SIZE;
+        }
+        if (i2cState == i2c_STATE_IDLE)
+            I2C_StartNext();
+    }
+    
+    IEC1SET = _IEC1_I2C1MIE_MASK;
+    IEC0SET = _IEC0_I2C1BIE_MASK;
+    return err;
 }
 
-/***	I2C_MasterStop
+/***	I2C_Wait
 **
 **	Parameters:
+**      i2c_Transaction *transaction - Queued transaction.
 **
 **	Return Value:
+**      int - Final status of the transaction (i2c_OK or error code).
 **
 **	Description:
-**		This function sends a stop condition to end communication on the I2C bus.
-**      It waits until the stop condition is sent before returning.
+**		This function waits for the completion of a queued transaction, checking the phase timeout.
 **      
 **          
 */
-void I2C_MasterStop() {
-    // send a STOP:
-    I2C1CONbits.PEN = 1; // comm is complete and master relinquishes bus
-    while(I2C1CONbits.PEN); // wait for STOP to complete
+int I2C_Wait(i2c_Transaction *transaction) {
+    while (transaction->status == i2c_PENDING)
+        I2C_CheckTimeout();
+    return transaction->status;
+}
+
+/***	I2C_Process
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function has to be called from the main loop: it checks the timeout of the running phase
+**      and calls the callbacks of the completed transactions. The read data is already in the buffer
+**      of the transaction, so no copy is made.
+**      
+**          
+*/
+void I2C_Process() {
+    I2C_CheckTimeout();
+    
+    while (i2cDoneHead != i2cDoneTail) {
+        i2c_Transaction *transaction = i2cDone[i2cDoneHead];
+        i2cDoneHead = (i2cDoneHead + 1) % I2C_QUEUE_SIZE;
+        transaction->callback(transaction);
+    }
+}
+
+/***	I2C_MasterEvent
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function advances the transaction engine by one bus phase.
+**      It is called by the I2C1 interrupt (main.c) at the end of each start, byte, ACK and stop phase.
+**      
+**          
+*/
+void I2C_MasterEvent() {
+    i2c_Transaction *transaction = i2cQueue[i2cHead];
+    
+    if (i2cState == i2c_STATE_IDLE)
+        return;
+    
+    if (I2C1STATbits.BCL) { // The recovery is left to I2C_CheckTimeout, out of the interrupt
+        i2cError = i2c_ERR_COLLISION;
+        i2cState = i2c_STATE_RECOVER;
+        IEC1CLR = _IEC1_I2C1MIE_MASK;
+        IEC0CLR = _IEC0_I2C1BIE_MASK;
+        return;
+    }
+    
+    i2cPhaseStart = TIMER_GetCoreTicks();
+    
+    switch (i2cState) {
+        case i2c_STATE_START:
+            i2cIndex = 0;
+            if (transaction->writeLen > 0 || transaction->readLen == 0) {
+                I2C1TRN = (transaction->address << 1) | i2c_MASTER_WRITE;
+                i2cState = i2c_STATE_ADDR_WRITE;
+            } else {
+                I2C1TRN = (transaction->address << 1) | i2c_MASTER_READ;
+                i2cState = i2c_STATE_ADDR_READ;
+            }
+            break;
+        case i2c_STATE_ADDR_WRITE:
+        case i2c_STATE_WRITE:
+            if (I2C1STATbits.ACKSTAT) {
+                I2C_SendStop(i2c_ERR_NACK);
+            } else if (i2cIndex < transaction->writeLen) {
+                I2C1TRN = transaction->writeData[i2cIndex++];
+                i2cState = i2c_STATE_WRITE;
+            } else if (transaction->readLen > 0) {
+                I2C1CONbits.RSEN = 1;
+                i2cState = i2c_STATE_RESTART;
+            } else {
+                I2C_SendStop(i2c_OK);
+            }
+            break;
+        case i2c_STATE_RESTART:
+            I2C1TRN = (transaction->address << 1) | i2c_MASTER_READ;
+            i2cState = i2c_STATE_ADDR_READ;
+            break;
+        case i2c_STATE_ADDR_READ:
+            if (I2C1STATbits.ACKSTAT) {
+                I2C_SendStop(i2c_ERR_NACK);
+            } else {
+                i2cIndex = 0;
+                I2C1CONbits.RCEN = 1;
+                i2cState = i2c_STATE_READ;
+            }
+            break;
+        case i2c_STATE_READ:
+            transaction->readData[i2cIndex++] = I2C1RCV;
+            I2C1CONbits.ACKDT = i2cIndex >= transaction->readLen; // NACK the last byte
+            I2C1CONbits.ACKEN = 1;
+            i2cState = i2c_STATE_ACK;
+            break;
+        case i2c_STATE_ACK:
+            if (i2cIndex < transaction->readLen) {
+                I2C1CONbits.RCEN = 1;
+                i2cState = i2c_STATE_READ;
+            } else {
+                I2C_SendStop(i2c_OK);
+            }
+            break;
+        case i2c_STATE_STOP:
+            I2C_Complete(i2cError);
+            break;
+    }
+}
+
+/***	I2C_CheckTimeout
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function terminates the running transaction with i2c_ERR_TIMEOUT if its current phase
+**      lasted more than I2C_WAIT_TIMEOUT, or with i2c_ERR_COLLISION if I2C_MasterEvent has flagged
+**      a collision, recovers the bus and starts the next transaction.
+**      The engine stays masked during the recovery and is enabled again only here.
+**      
+**          
+*/
+void I2C_CheckTimeout() {
+    IEC1CLR = _IEC1_I2C1MIE_MASK;
+    IEC0CLR = _IEC0_I2C1BIE_MASK;
+    
+    if (i2cState == i2c_STATE_RECOVER) {
+        I2C_Recover();
+        I2C_Complete(i2cError);
+    } else if (i2cState != i2c_STATE_IDLE && I2C_Expired(i2cPhaseStart)) {
+        I2C_Recover();
+        I2C_Complete(i2c_ERR_TIMEOUT);
+    }
+    
+    IEC1SET = _IEC1_I2C1MIE_MASK;
+    IEC0SET = _IEC0_I2C1BIE_MASK;
+}
+
+/***	I2C_StartNext
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function starts the transaction at the head of the queue, if any.
+**      
+**          
+*/
+void I2C_StartNext() {
+    if (i2cHead == i2cTail) {
+        i2cState = i2c_STATE_IDLE;
+        return;
+    }
+    
+    i2cError = i2c_OK;
+    i2cPhaseStart = TIMER_GetCoreTicks();
+    i2cState = i2c_STATE_START;
+    I2C1CONbits.SEN = 1;
+}
+
+/***	I2C_SendStop
+**
+**	Parameters:
+**      int status - Result of the running transaction.
+**
+**	Return Value:
+**
+**	Description:
+**		This function sends the stop condition that ends the running transaction.
+**      The result is reported once the stop has been sent.
+**      
+**          
+*/
+void I2C_SendStop(int status) {
+    i2cError = status;
+    I2C1CONbits.PEN = 1;
+    i2cState = i2c_STATE_STOP;
+}
+
+/***	I2C_Complete
+**
+**	Parameters:
+**      int status - Final status of the running transaction.
+**
+**	Return Value:
+**
+**	Description:
+**		This function removes the running transaction from the queue, hands it over to I2C_Process
+**      if it has a callback and immediately starts the next one.
+**      Transactions chained to a failed one are completed with i2c_ERR_ABORTED without using the bus.
+**      
+**          
+*/
+void I2C_Complete(int status) {
+    while (i2cHead != i2cTail) {
+        i2c_Transaction *transaction = i2cQueue[i2cHead];
+        int chained = transaction->flags & i2c_FLAG_CHAIN;
+        i2cHead = (i2cHead + 1) % I2C_QUEUE_SIZE;
+        
+        if (transaction->callback) {
+            i2cDone[i2cDoneTail] = transaction;
+            i2cDoneTail = (i2cDoneTail + 1) % I2C_QUEUE_SIZE;
+        }
+        transaction->status = status; // Last access: the owner may reuse it from now on
+        
+        if (status == i2c_OK || !chained)
+            break;
+        status = i2c_ERR_ABORTED;
+    }
+    
+    I2C_StartNext();
 }
@@ -10,21 +10,82 @@
 #ifndef I2C_H
 #define	I2C_H
 
-#define I2C_WAIT_TIMEOUT 0x0FFF
-#define I2C_TPGD 0.000000104
+#define I2C_WAIT_TIMEOUT 500 // maximum duration of one bus phase (us)
+#define I2C_RECOVERY_CLOCKS 9 // SCL pulses to release a stuck SDA
+#define I2C_TPGD_NS 104 // pulse gobbler delay (ns)
+
+/* supported bus rates (Hz) */
+#define i2c_FREQ_100K 100000 // Standard mode
+#define i2c_FREQ_400K 400000 // Fast mode
+#define i2c_FREQ_1M 1000000 // Fast mode Plus
+
+/* error codes */
+#define i2c_OK 0
+#define i2c_ERR_TIMEOUT -1 // bus phase not completed in I2C_WAIT_TIMEOUT
+#define i2c_ERR_NACK -2 // slave did not acknowledge
+#define i2c_ERR_COLLISION -3 // bus collision detected
+#define i2c_ERR_BUS -4 // SDA still held low after recovery
+#define i2c_ERR_FULL -5 // transaction queue full
+#define i2c_ERR_ABORTED -6 // not executed, the chained transaction before it failed
+#define i2c_PENDING 1 // transaction queued or running
+
+/* transaction queue */
+#define I2C_QUEUE_SIZE 8
+#define I2C_INT_PRIORITY 5
+
+#define i2c_FLAG_CHAIN 0x01 // the next queued transaction is aborted if this one fails
+
+/* engine states */
+#define i2c_STATE_IDLE 0
+#define i2c_STATE_START 1 // start condition sent
+#define i2c_STATE_ADDR_WRITE 2 // address + W sent
+#define i2c_STATE_WRITE 3 // data byte sent
+#define i2c_STATE_RESTART 4 // repeated start sent
+#define i2c_STATE_ADDR_READ 5 // address + R sent
+#define i2c_STATE_READ 6 // byte being received
+#define i2c_STATE_ACK 7 // ACK/NACK sent
+#define i2c_STATE_STOP 8 // stop condition sent
+#define i2c_STATE_RECOVER 9 // bus collision, recovery pending in I2C_CheckTimeout
+
+/* one bus transaction: [START addr+W write data] [RESTART addr+R read data] STOP */
+typedef struct i2c_Transaction i2c_Transaction;
+struct i2c_Transaction {
+    unsigned char address; // 7 bit slave address
+    unsigned char flags; // i2c_FLAG_x
+    const unsigned char *writeData; // bytes sent after the address (e.g. register pointer and values)
+    int writeLen;
+    unsigned char *readData; // filled in place, after a repeated start if writeLen > 0
+    int readLen;
+    void (*callback)(i2c_Transaction *transaction); // called by I2C_Process, 0 if not used
+    void *context; // client data for the callback
+    volatile int status; // i2c_PENDING, i2c_OK or error code
+};
 
 #define i2c_MASTER_WRITE 0
 #define i2c_MASTER_READ 1
 
 /* public functions */
-void I2C_Init(unsigned int i2cFreq);
-
-void I2C_MasterStart();
-void I2C_MasterRestart();
-unsigned char I2C_MasterSend(unsigned char byte);
-unsigned char I2C_MasterReceive();
-void I2C_MasterACK(int val);
-void I2C_MasterStop();
+unsigned int I2C_Init(unsigned int i2cFreq);
+unsigned int I2C_GetFrequency();
+void I2C_ClockChanged();
+int I2C_IsIdle();
+
+int I2C_Recover();
+
+int I2C_Submit(i2c_Transaction *transaction);
+int I2C_SubmitList(i2c_Transaction **transactions, int count);
+int I2C_Wait(i2c_Transaction *transaction);
+void I2C_Process();
+void I2C_MasterEvent();
+
+/* private functions */
+unsigned int I2C_Setup(unsigned int i2cFreq);
+int I2C_Expired(unsigned int start);
+void I2C_DelayUS(unsigned int us);
+void I2C_CheckTimeout();
+void I2C_StartNext();
+void I2C_Complete(int status);
+void I2C_SendStop(int status);
 
 #endif	/* I2C_H */
 
@@ -1,38 +1,46 @@
 #include "lcd.h"
+#include "boot.h"
+#include "clock.h"
 #include "config.h"
 #include "timer.h"
 #include <p32xxxx.h>
 
-/***	LCD_Init
+/***	LCD_InitStep
 **
 **	Parameters:
-**		
+**      int step - Step to be run (0 first).
 **
 **	Return Value:
-**		
+**      int - Microseconds to wait before the next step, boot_DONE after the last one.
 **
 **	Description:
-**		This function initializes the LCD by configuring the pins and PMP.
-**      It sets up the display with an 8-bit interface, 2 lines, and 5x7 dots.
-**      It also clears the display and sets the cursor to increment mode.
+**		This function runs one step of the display setup (boot task, see boot.h).
+**      Each wait is the execution time of the command from the HD44780 datasheet; the power-up
+**      wait is counted from the start of the boot, so it elapses during the other initializations.
 **      
 **          
 */
-void LCD_Init() {
-    LCD_ConfigurePins();
-    LCD_ConfigurePMP();
+int LCD_InitStep(int step) {
+    static const unsigned char commands[4] = {
+        0x38, // 8-bit interface, 2 lines, 5x7
+        0x0c, // ON, no cursor, no blink
+        0x01, // clear display
+        0x06 // increment cursor, no shift
+    };
+    static const unsigned short waits[4] = {LCD_CMD_US, LCD_CMD_US, LCD_CLEAR_US, LCD_CMD_US};
+    
+    if (step == 0) {
+        LCD_ConfigurePins();
+        LCD_ConfigurePMP();
+        unsigned int time = BOOT_GetTime();
+        return time < LCD_POWERUP_US ? LCD_POWERUP_US - time : 0;
+    }
+    if (step > 4)
+        return boot_DONE;
     
-    // Display setup
-    TIMER2_DelayMS(30);
     PMADDR = LCDCMD; // command register (ADDR = 0)
-    PMDATA = 0x38; // 8-bit interface, 2 lines, 5x7
-    TIMER2_DelayMS(1); // > 48us
-    PMDATA = 0x0c; // ON, no cursor, no blink
-    TIMER2_DelayMS(1); // > 48us
-    PMDATA = 0x01; // clear display
-    TIMER2_DelayMS(2); // > 1.6ms
-    PMDATA = 0x06; // increment cursor, no shift
-    TIMER2_DelayMS(2); // > 1.6ms
+    PMDATA = commands[step - 1];
+    return waits[step - 1];
 }
 
 /***	LCD_ConfigurePins
@@ -103,11 +111,14 @@ void LCD_ConfigurePMP() {
 **	Description:
 **		This function reads a byte from the specified address of the LCD.
 **      It waits for the PMP to be available before initiating the read cycle.
+**      Above LCD_MAX_PB the LCD is not accessed and 0 is returned.
 **      
 **          
 */
 char LCD_Read(int addr) {
     int dummy;
+    if (CLOCK_GetPB() > LCD_MAX_PB) // The PMP strobe would be shorter than the LCD enable pulse
+        return 0;
     while (PMMODEbits.BUSY); // Wait for PMP available
     
     PMADDR = addr; // select the command address
@@ -129,10 +140,14 @@ char LCD_Read(int addr) {
 **	Description:
 **		This function writes a byte to the specified address of the LCD.
 **      It waits for the LCD to be ready and the PMP to be available before writing.
+**      Above LCD_MAX_PB (clock_PROFILE_FULL) the write is dropped: the PMMODE waits are
+**      already at their maximum and the strobe would be out of the HD44780 timing.
 **      
 **          
 */
 void LCD_Write(int addr, char c) {
+    if (CLOCK_GetPB() > LCD_MAX_PB)
+        return;
     while(busyLCD()); // check busy flag of LCD
     while(PMMODEbits.BUSY); // wait for PMP available
     PMADDR = addr; //RS (0 or 1) for LCD
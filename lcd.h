@@ -30,6 +30,14 @@
 #define ansel_LCD_DB6 ANSELEbits.ANSE6
 #define ansel_LCD_DB7 ANSELEbits.ANSE7
 
+/* setup waits (HD44780 datasheet) */
+#define LCD_POWERUP_US 30000 // from the start of the boot
+#define LCD_CMD_US 50 // > 48us: 37us at the nominal 270 kHz, with margin for a slower oscillator
+#define LCD_CLEAR_US 1640 // > 1.52ms
+
+/* PMP timing: PMMODE waits at their maximum, 16 Tpb strobe (400 ns at 40 MHz, 200 ns at 80 MHz) */
+#define LCD_MAX_PB 40000000 // fastest peripheral clock the LCD is accessed at
+
 /* lcd utils */
 #define LCDDATA 1 // RS = 1 ; access data register
 #define LCDCMD 0 // RS = 0 ; access command register
@@ -44,7 +52,7 @@
 #define clrLCD() LCD_Write(LCDCMD, 1)
 
 /* public functions */
-void LCD_Init();
+int LCD_InitStep(int step);
 char LCD_Read(int addr);
 void LCD_Write(int addr, char c);
 void LCD_PutString(char *s);
@@ -0,0 +1,912 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "logger.h"
+#include "config.h"
+#include "spiflash.h"
+#include "timer.h"
+#include "uart.h"
+
+unsigned char logPages[LOGGER_PAGES][SPIFLASH_PAGE_SIZE]; // RAM page ring
+logger_Index logPageIndex[LOGGER_PAGES]; // summary of each RAM page
+int logFlashPage = 0; // next page to be programmed
+int logPagesReady = 0; // full pages waiting for the flash
+int logPageLen = 0; // bytes used in the page being filled
+logger_Codec logCodec; // compression state of the page being filled
+
+unsigned int logWriteAddr; // next flash page to program
+unsigned int logEraseAddr; // [logWriteAddr, logEraseAddr) is erased
+logger_Index logIndex; // summary of the pages programmed in the current sector
+unsigned int logTimeBase; // log time = logTimeBase + TIMER_GetMS()
+unsigned int logLastTime = 0; // time of the last record stored
+unsigned int logCount = 0; // records of the current session
+unsigned int logBytes = 0; // compressed bytes of the current session
+unsigned int logDropped = 0; // records lost in the current session
+unsigned char logRecording = 0;
+
+/***	LOGGER_Init
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function finds the end of the log in flash (binary search of the first erased data page,
+**      the log is always written in order), rebuilds the summary of the current sector and writes
+**      the index of the last full sector if a reset came before it, so a new session continues the log.
+**      It must be called after SPIFLASH_Init.
+**      
+**          
+*/
+void LOGGER_Init() {
+    unsigned int low = 0, high = logger_SECTORS * logger_DATA_PAGES;
+    
+    while (low < high) {
+        unsigned int mid = (low + high) / 2;
+        if (LOGGER_PageUsed(LOGGER_PageAddr(mid)))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    logWriteAddr = LOGGER_PageAddr(low);
+    
+    // A sector is erased before its first page is written, so only the current one is known to be erased
+    logEraseAddr = (logWriteAddr + SPIFLASH_SECTOR_SIZE - 1) & ~(SPIFLASH_SECTOR_SIZE - 1);
+    
+    memset(&logIndex, 0, sizeof(logIndex));
+    logLastTime = 0;
+    if (low % logger_DATA_PAGES) {
+        LOGGER_BuildIndex(low / logger_DATA_PAGES, &logIndex);
+        logLastTime = logIndex.last;
+    } else if (low > 0) {
+        int sector = low / logger_DATA_PAGES - 1;
+        unsigned int addr = SPIFLASH_LOG_ADDR + sector * SPIFLASH_SECTOR_SIZE + logger_INDEX_OFFSET;
+        logger_Index index;
+        
+        if (LOGGER_LoadIndex(sector, &index) < 0) {
+            LOGGER_BuildIndex(sector, &index);
+            if (!LOGGER_PageUsed(addr)) {
+                index.crc = SPIFLASH_CRC16(0xFFFF, (unsigned char *) &index, offsetof(logger_Index, crc));
+                SPIFLASH_ProgramVerify(addr, (unsigned char *) &index, sizeof(index)); // Rebuilt again if it fails
+            }
+        }
+        logLastTime = index.last;
+    }
+}
+
+/***	LOGGER_Start
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function starts a recording session. The log time continues from the last stored record.
+**      
+**          
+*/
+void LOGGER_Start() {
+    logTimeBase = logLastTime + 1 - TIMER_GetMS();
+    logFlashPage = 0;
+    logPagesReady = 0;
+    logPageLen = 0;
+    logCount = 0;
+    logBytes = 0;
+    logDropped = 0;
+    logRecording = 1;
+}
+
+/***	LOGGER_Add
+**
+**	Parameters:
+**      int sensor - Index of the sensor that produced the sample.
+**      clm_Sample *sample - Sample to be recorded.
+**      int red - 1 if the scan found the sample red, stored as logger_FLAG_RED.
+**
+**	Return Value:
+**      int - 0 if recorded, -1 if dropped (no free RAM page or log full).
+**
+**	Description:
+**		This function compresses a sample into the RAM page being filled. Full pages are programmed
+**      by LOGGER_Process, so this function never waits for the flash.
+**      
+**          
+*/
+int LOGGER_Add(int sensor, clm_Sample *sample, int red) {
+    logger_Record record;
+    logger_Codec next;
+    unsigned char buf[logger_MAX_RECORD];
+    int len;
+    
+    if (!logRecording || logPagesReady == LOGGER_PAGES || logWriteAddr >= SPIFLASH_LOG_END) {
+        logDropped++;
+        return -1;
+    }
+    
+    record.time = logTimeBase + TIMER_GetMS();
+    record.sensor = sensor;
+    record.flags = (sample->saturated ? logger_FLAG_SATURATED : 0) | (red ? logger_FLAG_RED : 0);
+    record.c = sample->raw[0]; // Raw counts: the log stays valid across a recalibration
+    record.r = sample->raw[1];
+    record.g = sample->raw[2];
+    record.b = sample->raw[3];
+    
+    next = logCodec;
+    len = LOGGER_EncodeRecord(buf, &record, &next);
+    
+    if (logPageLen + len > logger_PAGE_DATA) {
+        LOGGER_ClosePage();
+        if (logPagesReady == LOGGER_PAGES) {
+            logDropped++;
+            return -1;
+        }
+        next = logCodec; // Reset by LOGGER_ClosePage: the record becomes the keyframe of the new page
+        len = LOGGER_EncodeRecord(buf, &record, &next);
+    }
+    
+    int fill = (logFlashPage + logPagesReady) % LOGGER_PAGES;
+    unsigned char *page = logPages[fill];
+    if (logPageLen == 0) {
+        memset(page, logger_END, SPIFLASH_PAGE_SIZE); // Unused bytes stay erased
+        memset(&logPageIndex[fill], 0, sizeof(logger_Index));
+    }
+    memcpy(page + logPageLen, buf, len);
+    logPageLen += len;
+    LOGGER_IndexRecord(&logPageIndex[fill], &record);
+    logCodec = next;
+    
+    logLastTime = record.time;
+    logCount++;
+    logBytes += len;
+    return 0;
+}
+
+/***	LOGGER_ClosePage
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function queues the page being filled for programming and resets the compression state.
+**      
+**          
+*/
+void LOGGER_ClosePage() {
+    if (logPageLen > 0)
+        logPagesReady++;
+    logPageLen = 0;
+    memset(&logCodec, 0, sizeof(logCodec));
+}
+
+/***	LOGGER_Stop
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function ends the recording session: the partial page is queued and all the pages
+**      (and the index of a sector just filled) are written before returning.
+**      
+**          
+*/
+void LOGGER_Stop() {
+    if (!logRecording)
+        return;
+    
+    LOGGER_ClosePage();
+    
+    while ((logPagesReady > 0 || LOGGER_IndexDue()) && logWriteAddr < SPIFLASH_LOG_END)
+        LOGGER_Process();
+    logPagesReady = 0;
+    
+    SPIFLASH_WaitUntilNoBusy();
+    logRecording = 0;
+}
+
+/***	LOGGER_Process
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function has to be called from the main loop. When the flash is not busy it starts
+**      one operation: the program of the index of a full sector, the erase of the sector to be
+**      written, the program of a full page, or the erase of the following sector, so it is ready
+**      before the current one is filled.
+**      
+**          
+*/
+void LOGGER_Process() {
+    if (!logRecording || SPIFLASH_IsBusy())
+        return;
+    
+    if (logWriteAddr >= SPIFLASH_LOG_END) { // Log full
+        for (; logPagesReady > 0; logPagesReady--) {
+            logDropped += logPageIndex[logFlashPage].count;
+            logFlashPage = (logFlashPage + 1) % LOGGER_PAGES;
+        }
+        return;
+    }
+    
+    if (LOGGER_IndexDue()) {
+        logIndex.crc = SPIFLASH_CRC16(0xFFFF, (unsigned char *) &logIndex, offsetof(logger_Index, crc));
+        SPIFLASH_StartProgramPage(logWriteAddr, (unsigned char *) &logIndex, sizeof(logIndex));
+        logWriteAddr += SPIFLASH_PAGE_SIZE;
+        memset(&logIndex, 0, sizeof(logIndex));
+    } else if (logPagesReady > 0 && logEraseAddr <= logWriteAddr) {
+        SPIFLASH_StartEraseSector(logEraseAddr);
+        logEraseAddr += SPIFLASH_SECTOR_SIZE;
+    } else if (logPagesReady > 0) {
+        SPIFLASH_StartProgramPage(logWriteAddr, logPages[logFlashPage], SPIFLASH_PAGE_SIZE);
+        LOGGER_MergeIndex(&logIndex, &logPageIndex[logFlashPage]);
+        logWriteAddr += SPIFLASH_PAGE_SIZE;
+        logFlashPage = (logFlashPage + 1) % LOGGER_PAGES;
+        logPagesReady--;
+    } else if (logEraseAddr - logWriteAddr <= SPIFLASH_SECTOR_SIZE && logEraseAddr < SPIFLASH_LOG_END) {
+        SPIFLASH_StartEraseSector(logEraseAddr); // Erase ahead
+        logEraseAddr += SPIFLASH_SECTOR_SIZE;
+    }
+}
+
+/***	LOGGER_Dump
+**
+**	Parameters:
+**      unsigned int from - First log time (ms) to be sent.
+**      unsigned int to - Last log time (ms) to be sent.
+**
+**	Return Value:
+**      int - Number of pages sent.
+**
+**	Description:
+**		This function sends over UART, in binary frames, the compressed pages holding records
+**      with time in [from, to], followed by an empty frame. The pages are sent as stored
+**      (the host decoder filters the records), so the transfer is as short as the log itself.
+**      The sector indexes locate the range, only the pages of the sectors inside it are read.
+**      
+**          
+*/
+int LOGGER_Dump(unsigned int from, unsigned int to) {
+    unsigned char page[SPIFLASH_PAGE_SIZE];
+    logger_Index index;
+    int sent = 0;
+    
+    for (int sector = LOGGER_FindSector(from); LOGGER_ReadIndex(sector, &index) == 0 && index.first <= to; sector++) {
+        unsigned int addr = SPIFLASH_LOG_ADDR + sector * SPIFLASH_SECTOR_SIZE;
+        
+        for (int i = 0; i < logger_DATA_PAGES && addr < logWriteAddr; i++, addr += SPIFLASH_PAGE_SIZE) {
+            int len = LOGGER_ReadPage(addr, page, &index);
+            if (len > 0 && index.last >= from && index.first <= to) {
+                LOGGER_SendFrame(page, len);
+                sent++;
+            }
+        }
+    }
+    LOGGER_SendFrame(0, 0);
+    return sent;
+}
+
+/***	LOGGER_FindRed
+**
+**	Parameters:
+**      unsigned int from - First log time (ms) to be searched.
+**      unsigned int to - Last log time (ms) to be searched.
+**
+**	Return Value:
+**      int - Number of red events found.
+**
+**	Description:
+**		This function prints over UART the red events (a sensor that turns red, as counted
+**      by the scan) with time in [from, to]. Sectors without red records are skipped using
+**      their index, so only the pages of the sectors holding reds are read.
+**      
+**          
+*/
+int LOGGER_FindRed(unsigned int from, unsigned int to) {
+    unsigned char page[SPIFLASH_PAGE_SIZE];
+    unsigned char wasRed[clm_MAX_SENSORS] = {0};
+    logger_Index index;
+    logger_Record record;
+    logger_Codec codec;
+    char c[50];
+    int found = 0;
+    
+    for (int sector = LOGGER_FindSector(from); LOGGER_ReadIndex(sector, &index) == 0 && index.first <= to; sector++) {
+        unsigned int addr = SPIFLASH_LOG_ADDR + sector * SPIFLASH_SECTOR_SIZE;
+        
+        if (index.reds == 0) {
+            memset(wasRed, 0, sizeof(wasRed)); // The last records of the sector are not red
+            continue;
+        }
+        
+        for (int i = 0; i < logger_DATA_PAGES && addr < logWriteAddr; i++, addr += SPIFLASH_PAGE_SIZE) {
+            int pos = 0, len;
+            
+            SPIFLASH_Read(addr, page, SPIFLASH_PAGE_SIZE);
+            memset(&codec, 0, sizeof(codec));
+            while ((len = LOGGER_DecodeRecord(page + pos, logger_PAGE_DATA - pos, &record, &codec)) > 0) {
+                int red = LOGGER_IsRed(&record);
+                pos += len;
+                
+                if (red && !wasRed[record.sensor] && record.time >= from && record.time <= to) {
+                    snprintf(c, sizeof(c), "Rosso: %u ms, sensore %d\n", record.time, record.sensor);
+                    UART_PutString(c);
+                    found++;
+                }
+                wasRed[record.sensor] = red;
+            }
+        }
+    }
+    return found;
+}
+
+/***	LOGGER_FindSector
+**
+**	Parameters:
+**      unsigned int time - Log time (ms).
+**
+**	Return Value:
+**      int - First sector with records at or after time (number of used sectors if none).
+**
+**	Description:
+**		This function does a binary search on the sector indexes: a full log needs about
+**      10 index reads instead of a scan of the whole flash.
+**      
+**          
+*/
+int LOGGER_FindSector(unsigned int time) {
+    logger_Index index;
+    int low = 0, high = (logWriteAddr - SPIFLASH_LOG_ADDR + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE;
+    
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (LOGGER_ReadIndex(mid, &index) == 0 && index.last < time)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/***	LOGGER_ReadIndex
+**
+**	Parameters:
+**      int sector - Sector of the log (0 is the one at SPIFLASH_LOG_ADDR).
+**      logger_Index *index - Summary of the sector.
+**
+**	Return Value:
+**      int - 0 if the sector holds records, -1 otherwise.
+**
+**	Description:
+**		This function returns the index of a full sector, the summary kept in RAM for the sector
+**      being written, or the summary rebuilt from the pages if the index is damaged.
+**      
+**          
+*/
+int LOGGER_ReadIndex(int sector, logger_Index *index) {
+    int current = (logWriteAddr - SPIFLASH_LOG_ADDR) / SPIFLASH_SECTOR_SIZE;
+    
+    if (sector < 0 || sector > current) {
+        return -1;
+    } else if (sector == current) {
+        *index = logIndex;
+    } else if (LOGGER_LoadIndex(sector, index) < 0) {
+        LOGGER_BuildIndex(sector, index);
+    }
+    return index->count > 0 ? 0 : -1;
+}
+
+/***	LOGGER_Erase
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function erases the sectors used by the log.
+**      
+**          
+*/
+void LOGGER_Erase() {
+    for (unsigned int addr = SPIFLASH_LOG_ADDR; addr < logWriteAddr; addr += SPIFLASH_SECTOR_SIZE)
+        SPIFLASH_EraseSector(addr);
+    
+    logWriteAddr = SPIFLASH_LOG_ADDR;
+    logEraseAddr = SPIFLASH_LOG_ADDR;
+    memset(&logIndex, 0, sizeof(logIndex));
+    logLastTime = 0;
+}
+
+/***	LOGGER_GetCount
+**
+**	Parameters:
+**
+**	Return Value:
+**      unsigned int - Records stored in the current (or last) session.
+**
+**	Description:
+**		This function returns the number of recorded samples.
+**      
+**          
+*/
+unsigned int LOGGER_GetCount() {
+    return logCount;
+}
+
+/***	LOGGER_GetBytes
+**
+**	Parameters:
+**
+**	Return Value:
+**      unsigned int - Compressed bytes stored in the current (or last) session.
+**
+**	Description:
+**		This function returns the log space used by the session (LOGGER_GetCount * 14 without compression).
+**      
+**          
+*/
+unsigned int LOGGER_GetBytes() {
+    return logBytes;
+}
+
+/***	LOGGER_GetTime
+**
+**	Parameters:
+**      unsigned int ms - System time (TIMER_GetMS) during the recording session.
+**
+**	Return Value:
+**      unsigned int - Log time of that instant, as used by the records and by LOGGER_Dump.
+**
+**	Description:
+**		This function converts a system time to the log time of the current session.
+**      
+**          
+*/
+unsigned int LOGGER_GetTime(unsigned int ms) {
+    return logTimeBase + ms;
+}
+
+/***	LOGGER_GetDropped
+**
+**	Parameters:
+**
+**	Return Value:
+**      unsigned int - Records lost in the current (or last) session.
+**
+**	Description:
+**		This function returns the number of samples that could not be recorded.
+**      
+**          
+*/
+unsigned int LOGGER_GetDropped() {
+    return logDropped;
+}
+
+/***	LOGGER_IsFull
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - 1 if the log area is full.
+**
+**	Description:
+**		This function checks the free space of the log.
+**      
+**          
+*/
+int LOGGER_IsFull() {
+    return logWriteAddr >= SPIFLASH_LOG_END;
+}
+
+/***	LOGGER_EncodeRecord
+**
+**	Parameters:
+**      unsigned char *buf - Destination (at least logger_MAX_RECORD bytes).
+**      logger_Record *record - Record to be coded.
+**      logger_Codec *codec - Compression state, updated.
+**
+**	Return Value:
+**      int - Number of bytes written.
+**
+**	Description:
+**		This function codes a record against the previous one of the page (see logger.h).
+**      
+**          
+*/
+int LOGGER_EncodeRecord(unsigned char *buf, logger_Record *record, logger_Codec *codec) {
+    unsigned short values[4] = {record->c, record->r, record->g, record->b};
+    unsigned short *prev = codec->prev[record->sensor & logger_HDR_SENSOR];
+    unsigned char header = (record->sensor & logger_HDR_SENSOR) | ((record->flags & logger_FLAG_SATURATED) ? logger_HDR_SATURATED : 0) |
+            ((record->flags & logger_FLAG_RED) ? logger_HDR_RED : 0);
+    unsigned int dt = record->time - codec->time;
+    int delta[4], small = 1, len = 1;
+    
+    for (int i = 0; i < 4; i++) {
+        delta[i] = (int) values[i] - prev[i];
+        if (delta[i] < -8 || delta[i] > 7)
+            small = 0;
+        prev[i] = values[i];
+    }
+    
+    if (codec->count == 0)
+        len += LOGGER_PutVarint(buf + len, record->time); // Keyframe: absolute time
+    else if (dt == codec->dt)
+        header |= logger_HDR_SAME_DT;
+    else
+        len += LOGGER_PutVarint(buf + len, dt);
+    
+    if (small) {
+        header |= logger_HDR_NIBBLES;
+        buf[len++] = (delta[0] & 0x0F) | ((delta[1] & 0x0F) << 4);
+        buf[len++] = (delta[2] & 0x0F) | ((delta[3] & 0x0F) << 4);
+    } else {
+        for (int i = 0; i < 4; i++)
+            len += LOGGER_PutVarint(buf + len, ((unsigned int) delta[i] << 1) ^ (delta[i] >> 31)); // zig-zag
+    }
+    buf[0] = header;
+    
+    if (codec->count > 0)
+        codec->dt = dt;
+    codec->time = record->time;
+    codec->count++;
+    return len;
+}
+
+/***	LOGGER_DecodeRecord
+**
+**	Parameters:
+**      unsigned char *buf - Coded data.
+**      int len - Bytes available in buf.
+**      logger_Record *record - Decoded record.
+**      logger_Codec *codec - Decompression state (reset at the start of each page), updated.
+**
+**	Return Value:
+**      int - Number of bytes used, 0 at the end of the page or on corrupted data.
+**
+**	Description:
+**		This function decodes one record coded by LOGGER_EncodeRecord.
+**      
+**          
+*/
+int LOGGER_DecodeRecord(unsigned char *buf, int len, logger_Record *record, logger_Codec *codec) {
+    unsigned int value;
+    int pos = 1, n;
+    
+    if (len < 1 || buf[0] == logger_END || (buf[0] & 0x80))
+        return 0;
+    
+    unsigned char header = buf[0];
+    unsigned short *prev = codec->prev[header & logger_HDR_SENSOR];
+    
+    if (codec->count == 0 || !(header & logger_HDR_SAME_DT)) {
+        if (!(n = LOGGER_GetVarint(buf + pos, len - pos, &value)))
+            return 0;
+        pos += n;
+        if (codec->count == 0) {
+            record->time = value;
+        } else {
+            record->time = codec->time + value;
+            codec->dt = value;
+        }
+    } else {
+        record->time = codec->time + codec->dt;
+    }
+    
+    if (header & logger_HDR_NIBBLES) {
+        if (len - pos < 2)
+            return 0;
+        for (int i = 0; i < 4; i++) {
+            int delta = (buf[pos + i / 2] >> (4 * (i & 1))) & 0x0F;
+            prev[i] += delta >= 8 ? delta - 16 : delta;
+        }
+        pos += 2;
+    } else {
+        for (int i = 0; i < 4; i++) {
+            if (!(n = LOGGER_GetVarint(buf + pos, len - pos, &value)))
+                return 0;
+            pos += n;
+            prev[i] += (int) (value >> 1) ^ -(int) (value & 1); // zig-zag
+        }
+    }
+    
+    record->sensor = header & logger_HDR_SENSOR;
+    record->flags = ((header & logger_HDR_SATURATED) ? logger_FLAG_SATURATED : 0) | ((header & logger_HDR_RED) ? logger_FLAG_RED : 0);
+    record->c = prev[0];
+    record->r = prev[1];
+    record->g = prev[2];
+    record->b = prev[3];
+    
+    codec->time = record->time;
+    codec->count++;
+    return pos;
+}
+
+/***	LOGGER_PutVarint
+**
+**	Parameters:
+**      unsigned char *buf - Destination (up to 5 bytes).
+**      unsigned int value - Value to be coded.
+**
+**	Return Value:
+**      int - Number of bytes written.
+**
+**	Description:
+**		This function writes a varint: 7 bits per byte, least significant first, bit 7 set if more bytes follow.
+**      
+**          
+*/
+int LOGGER_PutVarint(unsigned char *buf, unsigned int value) {
+    int len = 0;
+    
+    while (value >= 0x80) {
+        buf[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf[len++] = value;
+    return len;
+}
+
+/***	LOGGER_GetVarint
+**
+**	Parameters:
+**      unsigned char *buf - Coded data.
+**      int len - Bytes available in buf.
+**      unsigned int *value - Decoded value.
+**
+**	Return Value:
+**      int - Number of bytes used, 0 if the varint is truncated or too long.
+**
+**	Description:
+**		This function reads a varint written by LOGGER_PutVarint.
+**      
+**          
+*/
+int LOGGER_GetVarint(unsigned char *buf, int len, unsigned int *value) {
+    *value = 0;
+    
+    for (int i = 0; i < len && i < 5; i++) {
+        *value |= (unsigned int) (buf[i] & 0x7F) << (7 * i);
+        if (!(buf[i] & 0x80))
+            return i + 1;
+    }
+    return 0;
+}
+
+/***	LOGGER_IsRed
+**
+**	Parameters:
+**      logger_Record *record - Record to be checked.
+**
+**	Return Value:
+**      int - 1 if the record is red.
+**
+**	Description:
+**		This function returns the red decision of the scan stored with the record: the test uses
+**      the calibrated channels and the red setting, which the raw counts of the log do not carry.
+**      
+**          
+*/
+int LOGGER_IsRed(logger_Record *record) {
+    return (record->flags & logger_FLAG_RED) != 0;
+}
+
+/***	LOGGER_ReadPage
+**
+**	Parameters:
+**      unsigned int addr - Flash address of a log page.
+**      unsigned char *page - Buffer for the page (SPIFLASH_PAGE_SIZE bytes).
+**      logger_Index *index - Summary of the records of the page.
+**
+**	Return Value:
+**      int - Bytes used by the records of the page, 0 if empty.
+**
+**	Description:
+**		This function reads and decodes a whole page.
+**      
+**          
+*/
+int LOGGER_ReadPage(unsigned int addr, unsigned char *page, logger_Index *index) {
+    logger_Record record;
+    logger_Codec codec;
+    int pos = 0, len;
+    
+    SPIFLASH_Read(addr, page, SPIFLASH_PAGE_SIZE);
+    memset(&codec, 0, sizeof(codec));
+    memset(index, 0, sizeof(logger_Index));
+    while ((len = LOGGER_DecodeRecord(page + pos, logger_PAGE_DATA - pos, &record, &codec)) > 0) {
+        LOGGER_IndexRecord(index, &record);
+        pos += len;
+    }
+    return pos;
+}
+
+/***	LOGGER_PageUsed
+**
+**	Parameters:
+**      unsigned int addr - Flash address of a log page.
+**
+**	Return Value:
+**      int - 1 if the page holds records.
+**
+**	Description:
+**		This function reads only the first byte of a page (0xFF if the page is erased).
+**      
+**          
+*/
+int LOGGER_PageUsed(unsigned int addr) {
+    unsigned char header;
+    SPIFLASH_Read(addr, &header, 1);
+    return header != logger_END;
+}
+
+/***	LOGGER_PageAddr
+**
+**	Parameters:
+**      unsigned int page - Data page number in the log.
+**
+**	Return Value:
+**      unsigned int - Flash address of the page (the index pages are skipped).
+**
+**	Description:
+**		This function maps the data pages of the log to the flash.
+**      
+**          
+*/
+unsigned int LOGGER_PageAddr(unsigned int page) {
+    return SPIFLASH_LOG_ADDR + (page / logger_DATA_PAGES) * SPIFLASH_SECTOR_SIZE + (page % logger_DATA_PAGES) * SPIFLASH_PAGE_SIZE;
+}
+
+/***	LOGGER_IndexRecord
+**
+**	Parameters:
+**      logger_Index *index - Summary to be updated.
+**      logger_Record *record - New record (in time order).
+**
+**	Return Value:
+**
+**	Description:
+**		This function adds a record to a summary.
+**      
+**          
+*/
+void LOGGER_IndexRecord(logger_Index *index, logger_Record *record) {
+    unsigned short values[4] = {record->c, record->r, record->g, record->b};
+    
+    if (index->count == 0) {
+        index->first = record->time;
+        memcpy(index->min, values, sizeof(values));
+        memcpy(index->max, values, sizeof(values));
+    }
+    for (int i = 0; i < 4; i++) {
+        if (values[i] < index->min[i])
+            index->min[i] = values[i];
+        if (values[i] > index->max[i])
+            index->max[i] = values[i];
+    }
+    index->last = record->time;
+    index->count++;
+    if (LOGGER_IsRed(record))
+        index->reds++;
+}
+
+/***	LOGGER_MergeIndex
+**
+**	Parameters:
+**      logger_Index *index - Summary to be updated.
+**      logger_Index *add - Summary of the following records.
+**
+**	Return Value:
+**
+**	Description:
+**		This function adds the summary of a page to the summary of its sector.
+**      
+**          
+*/
+void LOGGER_MergeIndex(logger_Index *index, logger_Index *add) {
+    if (add->count == 0)
+        return;
+    
+    if (index->count == 0) {
+        *index = *add;
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (add->min[i] < index->min[i])
+            index->min[i] = add->min[i];
+        if (add->max[i] > index->max[i])
+            index->max[i] = add->max[i];
+    }
+    index->last = add->last;
+    index->count += add->count;
+    index->reds += add->reds;
+}
+
+/***	LOGGER_LoadIndex
+**
+**	Parameters:
+**      int sector - Sector of the log.
+**      logger_Index *index - Index read from the flash.
+**
+**	Return Value:
+**      int - 0 if the index is valid, -1 if missing or damaged.
+**
+**	Description:
+**		This function reads the index page of a full sector and checks its CRC.
+**      
+**          
+*/
+int LOGGER_LoadIndex(int sector, logger_Index *index) {
+    SPIFLASH_Read(SPIFLASH_LOG_ADDR + sector * SPIFLASH_SECTOR_SIZE + logger_INDEX_OFFSET, (unsigned char *) index, sizeof(logger_Index));
+    
+    if (index->crc != SPIFLASH_CRC16(0xFFFF, (unsigned char *) index, offsetof(logger_Index, crc)))
+        return -1;
+    return 0;
+}
+
+/***	LOGGER_BuildIndex
+**
+**	Parameters:
+**      int sector - Sector of the log.
+**      logger_Index *index - Summary of the sector.
+**
+**	Return Value:
+**
+**	Description:
+**		This function rebuilds the summary of a sector by decoding its data pages.
+**      
+**          
+*/
+void LOGGER_BuildIndex(int sector, logger_Index *index) {
+    unsigned char page[SPIFLASH_PAGE_SIZE];
+    logger_Index pageIndex;
+    unsigned int addr = SPIFLASH_LOG_ADDR + sector * SPIFLASH_SECTOR_SIZE;
+    
+    memset(index, 0, sizeof(logger_Index));
+    for (int i = 0; i < logger_DATA_PAGES && LOGGER_ReadPage(addr, page, &pageIndex) > 0; i++, addr += SPIFLASH_PAGE_SIZE)
+        LOGGER_MergeIndex(index, &pageIndex);
+}
+
+/***	LOGGER_IndexDue
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - 1 if the data pages of the sector are written and its index is not.
+**
+**	Description:
+**		This function checks if the write position is on an index page.
+**      
+**          
+*/
+int LOGGER_IndexDue() {
+    return logWriteAddr < SPIFLASH_LOG_END && (logWriteAddr & (SPIFLASH_SECTOR_SIZE - 1)) == logger_INDEX_OFFSET;
+}
+
+/***	LOGGER_SendFrame
+**
+**	Parameters:
+**      unsigned char *payload - Frame payload.
+**      int len - Payload length (0 for the end frame).
+**
+**	Return Value:
+**
+**	Description:
+**		This function sends one binary frame over UART: SYNC1 SYNC2 LEN payload CRC16.
+**      
+**          
+*/
+void LOGGER_SendFrame(unsigned char *payload, int len) {
+    unsigned char length = len;
+    unsigned short crc = SPIFLASH_CRC16(0xFFFF, &length, 1);
+    crc = SPIFLASH_CRC16(crc, payload, len);
+    
+    UART_PutChar(logger_SYNC1);
+    UART_PutChar(logger_SYNC2);
+    UART_PutChar(length);
+    for (int i = 0; i < len; i++)
+        UART_PutChar(payload[i]);
+    UART_PutChar(crc);
+    UART_PutChar(crc >> 8);
+}
@@ -0,0 +1,119 @@
+/*
+ * File:   logger.h
+ * @brief Header file for the sample logger.
+ *
+ * This file contains the definitions and function prototypes for recording colorimeter samples in SPI flash
+ * and dumping them over UART.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef LOGGER_H
+#define	LOGGER_H
+
+#include "clm.h"
+#include "config.h"
+#include "spiflash.h"
+
+#define LOGGER_PAGES 8 // RAM page buffers: ~340 ms of samples at the fastest integration (2.4 ms)
+
+/*
+ * Compressed page: a sequence of records ended by 0xFF (erased byte), at most logger_PAGE_DATA bytes.
+ * Each page is a keyframe: the first record holds the absolute time and every sensor's first
+ * record is coded against zero, so a page can be decoded alone.
+ *
+ * record: header [dt] deltas
+ *   header  bit 0-2 sensor, bit 3 saturated, bit 4 same dt as the previous record (dt omitted),
+ *           bit 5 deltas packed in 4 bits, bit 6 red as decided by the scan, bit 7 always 0
+ *           (so the header is never 0xFF)
+ *   dt      varint, ms from the previous record (absolute log time for the first record)
+ *   deltas  c, r, g, b minus the previous values of the same sensor:
+ *           4 zig-zag varints, or 2 bytes of 4 bit fields (c | r << 4, g | b << 4) when all fit in -8..7
+ */
+#define logger_PAGE_DATA 255 // the frame length field is one byte
+#define logger_MAX_RECORD 18 // 1 + 5 + 4 * 3
+#define logger_END 0xFF
+
+#define logger_HDR_SENSOR 0x07
+#define logger_HDR_SATURATED 0x08
+#define logger_HDR_SAME_DT 0x10
+#define logger_HDR_NIBBLES 0x20
+#define logger_HDR_RED 0x40
+
+#define logger_FLAG_SATURATED 0x01
+#define logger_FLAG_RED 0x02 // calibrated r / (g + b) above the red setting when the sample was read
+
+/*
+ * Sector layout: logger_DATA_PAGES compressed pages followed by the index page of the sector, programmed
+ * when the sector is full. Queries read the indexes (binary search on time) and skip whole sectors.
+ */
+#define logger_DATA_PAGES (SPIFLASH_SECTOR_SIZE / SPIFLASH_PAGE_SIZE - 1)
+#define logger_INDEX_OFFSET (logger_DATA_PAGES * SPIFLASH_PAGE_SIZE)
+#define logger_SECTORS ((SPIFLASH_LOG_END - SPIFLASH_LOG_ADDR) / SPIFLASH_SECTOR_SIZE)
+
+/* dump frame: SYNC1 SYNC2 LEN payload CRC16 (over LEN and payload, little endian), LEN = 0 ends the dump.
+ * The payload is a compressed page (see tools/logdecode.c) */
+#define logger_SYNC1 0xA5
+#define logger_SYNC2 0x5A
+
+typedef struct {
+    unsigned int time; // log time (ms), monotonic across recording sessions
+    unsigned char sensor; // sensor index
+    unsigned char flags; // logger_FLAG_x
+    unsigned short c, r, g, b; // raw channel counts
+} logger_Record;
+
+/* summary of a sector (or of a RAM page) */
+typedef struct {
+    unsigned int first; // time of the first record
+    unsigned int last; // time of the last record
+    unsigned short count; // number of records, 0 if empty
+    unsigned short reds; // records with logger_FLAG_RED
+    unsigned short min[4]; // min c, r, g, b
+    unsigned short max[4]; // max c, r, g, b
+    unsigned short crc; // SPIFLASH_CRC16 of the fields above
+} logger_Index;
+
+/* encoder/decoder state, reset at the start of each page */
+typedef struct {
+    unsigned int time; // time of the previous record
+    unsigned int dt; // previous time step
+    unsigned short prev[clm_MAX_SENSORS][4]; // previous c, r, g, b of each sensor
+    int count; // records coded in the page
+} logger_Codec;
+
+/* public functions */
+void LOGGER_Init();
+void LOGGER_Start();
+int LOGGER_Add(int sensor, clm_Sample *sample, int red);
+void LOGGER_Stop();
+void LOGGER_Process();
+int LOGGER_Dump(unsigned int from, unsigned int to);
+int LOGGER_FindRed(unsigned int from, unsigned int to);
+int LOGGER_FindSector(unsigned int time);
+int LOGGER_ReadIndex(int sector, logger_Index *index);
+void LOGGER_Erase();
+unsigned int LOGGER_GetCount();
+unsigned int LOGGER_GetBytes();
+unsigned int LOGGER_GetTime(unsigned int ms);
+unsigned int LOGGER_GetDropped();
+int LOGGER_IsFull();
+int LOGGER_EncodeRecord(unsigned char *buf, logger_Record *record, logger_Codec *codec);
+int LOGGER_DecodeRecord(unsigned char *buf, int len, logger_Record *record, logger_Codec *codec);
+int LOGGER_IsRed(logger_Record *record);
+int LOGGER_ReadPage(unsigned int addr, unsigned char *page, logger_Index *index);
+
+/* private functions */
+int LOGGER_PutVarint(unsigned char *buf, unsigned int value);
+int LOGGER_GetVarint(unsigned char *buf, int len, unsigned int *value);
+void LOGGER_ClosePage();
+int LOGGER_PageUsed(unsigned int addr);
+unsigned int LOGGER_PageAddr(unsigned int page);
+void LOGGER_IndexRecord(logger_Index *index, logger_Record *record);
+void LOGGER_MergeIndex(logger_Index *index, logger_Index *add);
+int LOGGER_LoadIndex(int sector, logger_Index *index);
+void LOGGER_BuildIndex(int sector, logger_Index *index);
+int LOGGER_IndexDue();
+void LOGGER_SendFrame(unsigned char *payload, int len);
+
+#endif	/* LOGGER_H */
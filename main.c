@@ -12,15 +12,24 @@
 #include <p32xxxx.h>
 
 #include "audio.h"
+#include "boot.h"
 #include "clm.h"
+#include "clock.h"
 #include "config.h"
 #include "gpio.h"
+#include "i2c.h"
 #include "lcd.h"
+#include "logger.h"
+#include "power.h"
+#include "counter.h"
+#include "settings.h"
+#include "sounds.h"
 #include "spiflash.h"
+#include "system.h"
 #include "timer.h"
 #include "uart.h"
 
-// PB_CLOCK 40MHz
+// SYS_CLOCK 80MHz, PB_CLOCK SYS_CLOCK / PB_DIV (config.h)
 #pragma config JTAGEN = OFF     
 #pragma config FWDTEN = OFF
 
@@ -29,7 +38,11 @@
 #pragma config FSOSCEN = OFF
 #pragma config POSCMOD = XT
 #pragma config OSCIOFNC = ON
+#if PB_DIV == 1
+#pragma config FPBDIV = DIV_1
+#else
 #pragma config FPBDIV = DIV_2
+#endif
 
 // Device Config Bits in DEVCFG2
 #pragma config FPLLIDIV = DIV_2
@@ -39,8 +52,16 @@
 /* Global variables [START] */
 unsigned char waitUser = 0;
 unsigned char mode = 0;
-
-unsigned char btncFlag = 0;
+unsigned char showLux = 0; // Scan mode shows lux/CCT instead of RGB
+unsigned char hdrMode = 0; // Scan mode uses the HDR acquisition
+unsigned char calStep = 0; // Calibration step waiting for the user (0 = none)
+unsigned short calDark[clm_MAX_SENSORS][4]; // Dark references captured in the first step
+unsigned char recordMode = 0; // Scan mode records the samples in flash
+unsigned char sonifyMode = 0; // Scan mode plays the colour of the first sensor
+unsigned char ledMode = 0; // Scan mode shows the colour of the first sensor on the RGB LED
+unsigned char pcmUpload = 0; // The received lines are the hex samples of a PCM clip (tools/pcmupload.c)
+counter_Counter redCount; // Reds found since the last reset (function 3), stored in flash
+volatile unsigned int msTicks = 0; // 1ms system tick (Timer 2)
 
 unsigned char uartFlag = 0;
 unsigned int uartCount = 0;
@@ -57,44 +78,162 @@ UART4MessageHandler() {
 
 void __attribute__((interrupt(IPL7AUTO), vector(_EXTERNAL_4_VECTOR)))
 BTNCClickHandler() {
-    btncFlag = 1; // BTNC clicked: flag on
-    IFS0bits.INT4IF = 0; // Clear the INT4 interrupt flag
+    BTNC_Edge(); // Timestamp the edge, debounced in the main loop
+    IFS0CLR = _IFS0_INT4IF_MASK; // Clear the INT4 interrupt flag
+}
+
+void __attribute__((interrupt(IPL4AUTO), vector(_TIMER_2_VECTOR)))
+Timer2TickHandler() {
+    msTicks++;
+    AUDIO_Tick(); // Next note of the tone sequencer
+    RGB_Tick(); // Next step of the LED pattern
+    IFS0CLR = _IFS0_T2IF_MASK; // Clear the Timer2 interrupt flag
+}
+
+void __attribute__((interrupt(IPL3AUTO), vector(_TIMER_3_VECTOR)))
+Timer3PeriodHandler() {
+    AUDIO_PeriodEvent(); // New sonification period at the boundary
+    IFS0CLR = _IFS0_T3IF_MASK; // Clear the Timer3 interrupt flag
+}
+
+void __attribute__((interrupt(IPL2AUTO), vector(_DMA_0_VECTOR)))
+DMA0PcmHandler() {
+    AUDIO_PcmEvent(); // Half of the PCM ring played, or end of the clip
+    IFS1CLR = _IFS1_DMA0IF_MASK; // Clear the DMA channel 0 interrupt flag
+}
+
+void __attribute__((interrupt(IPL5AUTO), vector(_I2C_1_VECTOR)))
+I2C1EventHandler() {
+    IFS1CLR = _IFS1_I2C1MIF_MASK; // Clear the I2C1 master and bus collision flags
+    IFS0CLR = _IFS0_I2C1BIF_MASK;
+    I2C_MasterEvent(); // Next phase of the queued transactions
 }
 /* Interrupts [END] */
 
+void printBusError(int index) {
+    char uartPrint[50];
+    snprintf(uartPrint, sizeof(uartPrint), "Errore I2C sensore %d (%u errori)\n", index, CLM_GetSensor(index)->busErrors);
+    UART_PutString(uartPrint);
+    if (!AUDIO_IsPlaying())
+        AUDIO_PlayPattern(audio_PATTERN_ERROR); // Not queued again while a bus error repeats
+}
+
+void startScan() {
+    CLOCK_SetProfile(clock_PROFILE_NORMAL); // Before the sensor transactions start
+    UART_PutString("Scansione colori...\n");
+    
+    /* Scan beep [START] */
+    // Start scan with a beep (default 0.5 second at 10kHz), played while scanning
+    if (sonifyMode)
+        AUDIO_SonifyStart();
+    else
+        AUDIO_PlayPattern(audio_PATTERN_SCAN);
+    /* Scan beep [END] */
+    CLM_ScanStart();
+    if (recordMode)
+        LOGGER_Start();
+    mode = 1;
+}
+
+void stopScan() {
+    AUDIO_SonifyStop();
+    if (ledMode)
+        RGB_SetColor(0, 0, 0);
+    if (recordMode) {
+        LOGGER_Stop();
+        char c[80];
+        snprintf(c, sizeof(c), "Registrati %u campioni (%u byte), persi %u\n", LOGGER_GetCount(), LOGGER_GetBytes(), LOGGER_GetDropped());
+        UART_PutString(c);
+    }
+    
+    mode = 0;
+    waitUser = 0; // Show the menu again
+}
+
+void toggleRecord() {
+    recordMode = !recordMode;
+    if (recordMode && LOGGER_IsFull())
+        UART_PutString("Log pieno, cancellalo con la funzione 10\n");
+    UART_PutString(recordMode ? "Registrazione attiva\n" : "Registrazione disattivata\n");
+}
+
+void markSample(unsigned int ms) {
+    char uartPrint[40];
+    
+    // Log time while recording, so the mark can be used as a range of functions 9 and 11
+    snprintf(uartPrint, sizeof(uartPrint), "Marcatore: %u ms\n", recordMode ? LOGGER_GetTime(ms) : ms);
+    UART_PutString(uartPrint);
+    AUDIO_PlayNote(4000, 40, 50); // Short click
+}
+
 /*
  * 
  */
 int main(int argc, char** argv) {
     /* Initialize program [START] */
-    AUDIO_Init();
+    BOOT_Start(); // Boot clock: the power-up waits of the boot tasks are counted from here
+    SYSTEM_Init(); // Flash wait states, prefetch and cache
+    POWER_Init(); // Idle mode for WAIT, unused peripherals off
+    int lcdTask = BOOT_Add("LCD", LCD_InitStep); // Display power-up elapses during the other initializations
+    SPIFLASH_Init();
+    SETTINGS_Init(); // Operating parameters, used by the following modules
     TIMER2_Init();
-    UART_Init(9600);
-    LCD_Init();
-    CLM_Init();
+    UART_Init(SETTINGS_Get(settings_BAUD));
+    
+    // Enable interrupts (the I2C transactions of the sensors setup are interrupt driven)
+    macro_enable_interrupts();
+    
+    int clmTask = BOOT_Add("sensori", CLM_InitStep); // All the sensors powered on together
+    AUDIO_Init();
+    AUDIO_SetBeep(SETTINGS_Get(settings_BEEP), SETTINGS_Get(settings_BEEP_MS));
     RGB_Init();
     BTNC_Init();
-    SPIFLASH_Init();
+    BOOT_Wait(clmTask); // Sensors configured 2.4 ms after PON: the first integration starts
     
-    // Enable interrupts
-    macro_enable_interrupts();
+    COUNTER_Init(&redCount, SPIFLASH_COUNTER_ADDR);
+    LOGGER_Init(); // Find the end of the sample log, still during the display power-up
+    BOOT_Wait(lcdTask);
+    BOOT_Add("primo campione", CLM_FirstSampleStep); // Completed by the main loop
     
     char lcdData[20];
-    unsigned short redCounter = 0;
     unsigned int colors[3];
-    unsigned char checkRed = 0; // When a red is founded wait for a diff. color
+    clm_Sample sample;
+    unsigned int hdrChannels[4];
+    unsigned char checkRed[clm_MAX_SENSORS]; // When a red is founded wait for a diff. color
+    int sensorIndex;
+    unsigned char bootReported = 0;
     
     for (int i = 0; i < 3; i++) {
         colors[i] = 0;
     }
     
-    if (CLM_GetID() != 0x44 || SPIFLASH_ReleasePowerDownGetDeviceID() != 0x15) {
+    for (int i = 0; i < clm_MAX_SENSORS; i++) {
+        checkRed[i] = 0;
+    }
+    
+    if (CLM_GetID(CLM_GetSensor(0)) != 0x44 || SPIFLASH_ReleasePowerDownGetDeviceID() != 0x15) {
         LCD_PutString("Errore periferiche");
         return (EXIT_FAILURE);
     }
+    
+    if (CLM_LoadCalibration() < CLM_GetSensorCount()) {
+        UART_PutString("Calibrazione non trovata, uso valori di default\n");
+    }
     /* Initialize program [END] */
     
     while (1) {
+        CLOCK_SetProfile(mode == 0 ? clock_PROFILE_LOW : clock_PROFILE_NORMAL); // Retried while I2C is busy
+        if (!uartFlag)
+            POWER_Idle(mode); // CPU stopped until the next interrupt (the 1 ms tick at the latest)
+        
+        I2C_Process(); // I2C timeouts and completion callbacks
+        LOGGER_Process(); // Program the recorded pages in background
+        AUDIO_PcmProcess(); // Refill the PCM ring from flash
+        if (!bootReported && !BOOT_Process()) { // First sample ready: boot times over UART
+            BOOT_Report();
+            bootReported = 1;
+        }
+        
         /* Interrupts logic [START] */
         if (uartFlag) {
             if (mode == 0)            
@@ -102,28 +241,18 @@ int main(int argc, char** argv) {
             uartFlag = 0;
         }
         
-        if (btncFlag) {
-            if (mode == 1) { // Get only in scan mode                
-                /* Saving in flash memory [START] */
-                SPIFALSH_Write2Byte(SPIFLASH_PROG_ADDR, redCounter);
-                
-                TIMER2_DelayMS(100);
-                
-                // Check if data are correctly writed
-                unsigned short readValue = SPIFLASH_Read2Byte(SPIFLASH_PROG_ADDR);
-                if (readValue != redCounter) {
-                    char c[100];
-                    snprintf(c, sizeof(c), "Errore nella scrittura della memoria flash: scritto %d, letto %d\n", redCounter, readValue);
-                    UART_PutString(c);
-                }
-                
-                redCounter = 0; // Reset red counter
-                /* Saving in flash memory [END] */
-                
-                mode = 0;
+        int btncEvent = BTNC_GetEvent();
+        if (btncEvent != btnc_EVENT_NONE) {
+            RGB_Stop(); // Cancel the LED pattern
+            if (mode == 1 && btncEvent == btnc_EVENT_DOUBLE) {
+                markSample(BTNC_GetEventTime()); // Double click marks the samples
+            } else if (mode == 1) {
+                stopScan();
+            } else if (mode == 0 && !calStep && btncEvent == btnc_EVENT_SHORT) {
+                startScan(); // Same as function 1
+            } else if (mode == 0 && !calStep && btncEvent == btnc_EVENT_LONG) {
+                toggleRecord(); // Same as function 8
             }
-            
-            btncFlag = 0; // Reset flag
         }
         /* Interrupts logic [END] */
         
@@ -132,53 +261,114 @@ int main(int argc, char** argv) {
             UART_PutString("1. avvio della scansione colorimetrica\n");
             UART_PutString("2. visualizza il n. di volte che e stato rilevato il colore rosso\n");
             UART_PutString("3. reset colori salvati\n");
+            UART_PutString("4. mostra lux e temperatura colore durante la scansione (on/off)\n");
+            UART_PutString("5. calibrazione (buio e bianco)\n");
+            UART_PutString("6. modalita HDR (on/off)\n");
+            UART_PutString("7. misura lettura I2C (7 100/400/1000 cambia velocita in kHz)\n");
+            UART_PutString("8. registra i campioni in flash durante la scansione (on/off)\n");
+            UART_PutString("9. invia il log in binario (9 da a, tempi in ms)\n");
+            UART_PutString("10. cancella il log\n");
+            UART_PutString("11. cerca i rossi nel log (11 da a, tempi in ms)\n");
+            UART_PutString("12. sonificazione del colore durante la scansione (on/off)\n");
+            UART_PutString("13. riproduci la clip audio (pcm frequenza campioni per caricarla)\n");
+            UART_PutString("14. LED RGB con il colore misurato durante la scansione (on/off)\n");
+            UART_PutString("15. consumo stimato per modalita (15 reset per azzerare)\n");
+            UART_PutString("16. benchmark della configurazione di flash e cache\n");
+            UART_PutString("list, get nome, set nome valore: parametri di funzionamento\n");
             waitUser = 1;
         } else if (mode == 1) { // Scan mode
             /* Get & print color value [START] */
-            CLM_GetColorData(colors);
+            if (hdrMode) {
+                sensorIndex = 0; // HDR runs on the first sensor
+                int hdrResult = CLM_HDRPoll(CLM_GetSensor(0), hdrChannels);
+                if (hdrResult == clm_PENDING)
+                    continue; // Exposure still integrating
+                if (hdrResult < 0) { // No valid reading, hdrChannels not written
+                    if (hdrResult != clm_ERR_NO_EXPOSURE)
+                        printBusError(0);
+                    continue;
+                }
+                CLM_NormalizeChannels(hdrChannels, colors);
+            } else {
+                sensorIndex = CLM_ScanPoll(&sample);
+                if (sensorIndex < 0)
+                    continue; // No sensor completed an integration yet
+                if (sample.status) {
+                    printBusError(sensorIndex);
+                    continue;
+                }
+                CLM_SampleToColors(&sample, colors);
+            }
 
-            cmdLCD(0x80);
+            // Red if r / (g + b) > threshold (default 1), the decision is also logged with the sample
+            float gb = colors[1] + colors[2];
+            int isRed = gb > 0 && (float)colors[0] / gb > SETTINGS_Get(settings_RED) / 100.0f;
+            if (recordMode && !hdrMode)
+                LOGGER_Add(sensorIndex, &sample, isRed);
 
-            snprintf(lcdData, sizeof(lcdData), "R: %d, G: %d            ", colors[0], colors[1]);
-            LCD_PutString(lcdData);
+            if (sensorIndex == 0 && sonifyMode) {
+                if (hdrMode)
+                    AUDIO_Sonify(hdrChannels[1], hdrChannels[2], hdrChannels[3], hdrChannels[0]);
+                else
+                    AUDIO_Sonify(sample.r, sample.g, sample.b, sample.c);
+            }
 
-            line2LCD();
-            
-            snprintf(lcdData, sizeof(lcdData), "B: %d            ", colors[2]);
-            LCD_PutString(lcdData);
+            if (sensorIndex == 0 && ledMode)
+                RGB_ShowColor(colors[0], colors[1], colors[2]);
+
+            // The LCD shows the first sensor only
+            if (sensorIndex == 0 && showLux && !hdrMode) {
+                cmdLCD(0x80);
+
+                snprintf(lcdData, sizeof(lcdData), "Lux: %u            ", sample.lux);
+                LCD_PutString(lcdData);
+
+                line2LCD();
+
+                snprintf(lcdData, sizeof(lcdData), "CCT: %u K            ", sample.cct);
+                LCD_PutString(lcdData);
+            } else if (sensorIndex == 0) {
+                cmdLCD(0x80);
+
+                snprintf(lcdData, sizeof(lcdData), "R: %d, G: %d            ", colors[0], colors[1]);
+                LCD_PutString(lcdData);
+
+                line2LCD();
+
+                snprintf(lcdData, sizeof(lcdData), "B: %d            ", colors[2]);
+                LCD_PutString(lcdData);
+            }
             /* Get & print color value [END] */
                         
             // Check if is red and increment var
-            float gb = colors[1] + colors[2];
-            if (gb > 0) {
-                float redRatio = (float)colors[0] / gb; // r / (g + b) > 1 is red
-
-                if (redRatio > 1 && !checkRed) {
-                    // Count a new red if it is different from the last
-                    checkRed = 1;
-                    redCounter++;
-                } else if (redRatio <= 1) {
-                    checkRed = 0;
+            if (isRed && !checkRed[sensorIndex]) {
+                // Count a new red if it is different from the last
+                checkRed[sensorIndex] = 1;
+                AUDIO_PlayPattern(audio_PATTERN_RED);
+                if (COUNTER_Increment(&redCount)) { // Stored in flash at every red
+                    UART_PutString("Errore nella scrittura della memoria flash\n");
+                    AUDIO_PlayPattern(audio_PATTERN_ERROR);
                 }
-            } else {
-                // If g and b are 0
-                checkRed = 0;
+            } else if (!isRed) {
+                checkRed[sensorIndex] = 0; // Also when g and b are 0
             }
         } else if (mode == 2) { // Show mode
             /* Show stored times [START] */
-            unsigned short mem = SPIFLASH_Read2Byte(SPIFLASH_PROG_ADDR);
+            unsigned int mem = COUNTER_Get(&redCount);
             
             char uartMemPrint[40];
-            snprintf(uartMemPrint, sizeof(uartMemPrint), "Rosso visualizzato %d volte\n", mem);
+            snprintf(uartMemPrint, sizeof(uartMemPrint), "Rosso visualizzato %u volte\n", mem);
             UART_PutString(uartMemPrint);
             
-            RED_Pulse(mem);
+            RGB_ShowCount(mem, 255, 0, 0); // Played in background, cancelled by a command or BTNC
             /* Show stored times [END] */
             
             mode = 0;
         } else if (mode == 3) { // Erease memory
-            SPIFLASH_EraseAll();
-            UART_PutString("Memoria cancellata!\n");
+            if (COUNTER_Reset(&redCount)) // Keep the calibration sector
+                UART_PutString("Errore nella scrittura della memoria flash\n");
+            else
+                UART_PutString("Memoria cancellata!\n");
             mode = 0;
         }
     }
@@ -193,6 +383,160 @@ void clearArray(int *array, int size) {
     }
 }
 
+void calibrationStep() {
+    unsigned short white[4];
+    clm_Calibration cal[clm_MAX_SENSORS];
+    char uartPrint[60];
+    
+    if (calStep == 1) {
+        for (int i = 0; i < CLM_GetSensorCount(); i++) {
+            if (CLM_CaptureReference(CLM_GetSensor(i), calDark[i])) {
+                printBusError(i);
+                calStep = 0;
+                return;
+            }
+        }
+        UART_PutString("Posiziona il riferimento bianco e premi invio\n");
+        calStep = 2;
+    } else {
+        // Compute every sensor first: the calibration is applied only if all of them succeed
+        for (int i = 0; i < CLM_GetSensorCount(); i++) {
+            if (CLM_CaptureReference(CLM_GetSensor(i), white)) {
+                printBusError(i);
+                calStep = 0;
+                return;
+            }
+            if (CLM_ComputeCalibration(&cal[i], calDark[i], white)) {
+                sprintf(uartPrint, "Errore: riferimento bianco non valido (sensore %d)\n", i);
+                UART_PutString(uartPrint);
+                calStep = 0;
+                return;
+            }
+        }
+        
+        for (int i = 0; i < CLM_GetSensorCount(); i++)
+            CLM_SetCalibration(CLM_GetSensor(i), &cal[i]);
+        if (CLM_SaveCalibration())
+            UART_PutString("Errore nella scrittura della memoria flash\n");
+        else
+            UART_PutString("Calibrazione salvata\n");
+        calStep = 0;
+    }
+}
+
+void i2cMeasure(unsigned int freq) {
+    unsigned char values[8];
+    char uartPrint[60];
+    
+    if (freq) {
+        if (freq != i2c_FREQ_100K && freq != i2c_FREQ_400K && freq != i2c_FREQ_1M) {
+            UART_PutString("Velocita non supportata\n");
+            return;
+        }
+        if (!I2C_Init(freq)) {
+            I2C_Init(i2c_FREQ_400K);
+            UART_PutString("Velocita non ottenibile con il PB clock attuale\n");
+            return;
+        }
+        if (freq > i2c_FREQ_400K)
+            UART_PutString("Attenzione: il TCS34725 e garantito fino a 400kHz\n");
+    }
+    
+    // Time the 8 byte RGBC burst (address, command, restart, address, 8 data bytes)
+    unsigned int start = TIMER_GetCoreTicks();
+    int err = CLM_I2CGetColorData(CLM_GetSensor(0), values);
+    unsigned int ticks = TIMER_GetCoreTicks() - start;
+    
+    if (err) {
+        printBusError(0);
+        return;
+    }
+    
+    // 12 bytes of 9 clocks each, plus start, restart and stop conditions
+    unsigned int us = ticks / CORE_TICKS_PER_US;
+    unsigned int rate = us ? 108000 / us : 0;
+    
+    snprintf(uartPrint, sizeof(uartPrint), "I2C %u Hz: lettura %u us (~%u kHz)\n", I2C_GetFrequency(), us, rate);
+    UART_PutString(uartPrint);
+}
+
+void settingsCommand() {
+    char *name = (char *) uartData + 4, *value = strchr(name, ' ');
+    char uartPrint[60];
+    
+    if (value)
+        *value++ = 0; // Split name and value
+    
+    int key = SETTINGS_Find(name);
+    if (key < 0) {
+        UART_PutString("Parametro sconosciuto (list per l'elenco)\n");
+        return;
+    }
+    
+    if (uartData[0] == 's') {
+        int err = value ? SETTINGS_Set(key, strtoul(value, 0, 10)) : -1;
+        if (err == -1) {
+            char range[100];
+            SETTINGS_FormatRange(key, range, sizeof(range));
+            UART_PutString("Valore non valido (");
+            UART_PutString(range);
+            UART_PutString(")\n");
+            return;
+        } else if (err) {
+            UART_PutString("Errore nella scrittura della memoria flash, valore non cambiato\n");
+            return;
+        }
+        
+        // Apply the new value only once saved (the baud rate is used at the next boot)
+        if (key == settings_ITIME || key == settings_GAIN || key == settings_WAIT) {
+            for (int i = 0; i < CLM_GetSensorCount(); i++)
+                CLM_Config(CLM_GetSensor(i), SETTINGS_Get(settings_ITIME));
+        } else if (key == settings_BEEP || key == settings_BEEP_MS) {
+            AUDIO_SetBeep(SETTINGS_Get(settings_BEEP), SETTINGS_Get(settings_BEEP_MS));
+        }
+    }
+    
+    snprintf(uartPrint, sizeof(uartPrint), "%s = %u\n", name, SETTINGS_Get(key));
+    UART_PutString(uartPrint);
+}
+
+void pcmUploadCommand() {
+    char *end;
+    unsigned int rate = strtoul((char *) uartData + 4, &end, 10);
+    unsigned int length = strtoul(end, 0, 10);
+    
+    AUDIO_Stop();
+    if (AUDIO_PcmUploadStart(SPIFLASH_PCM_ADDR, SPIFLASH_LOG_ADDR, rate, length)) {
+        UART_PutString("Clip non valida (pcm frequenza campioni)\n");
+        return;
+    }
+    pcmUpload = 1;
+    UART_PutString("Invia i campioni\n");
+}
+
+void pcmUploadLine() {
+    unsigned char samples[AUDIO_PCM_UPLOAD_LINE];
+    unsigned int digits = strlen((char *) uartData), len = 0;
+    int left = -1;
+    
+    if (digits % 2 == 0 && digits <= 2 * AUDIO_PCM_UPLOAD_LINE) {
+        for (; len < digits / 2 && isxdigit(uartData[2 * len]) && isxdigit(uartData[2 * len + 1]); len++) {
+            char pair[3] = {uartData[2 * len], uartData[2 * len + 1], 0};
+            samples[len] = strtoul(pair, 0, 16);
+        }
+        if (len == digits / 2)
+            left = AUDIO_PcmUploadData(samples, len);
+    }
+    
+    if (left < 0) {
+        pcmUpload = 0;
+        UART_PutString("Errore nel caricamento della clip, caricamento annullato\n");
+    } else if (left == 0) {
+        pcmUpload = 0;
+        UART_PutString("Clip salvata\n");
+    }
+}
+
 void uartManageData() {
     char newChar = uartData[uartCount - 1];
 
@@ -205,6 +549,7 @@ void uartManageData() {
         }
     } else if (newChar == 0xA) { // Check the string when last char of data is enter (newline)
         uartData[--uartCount] = 0; // Remove the enter character
+        RGB_Stop(); // A new command cancels the LED pattern
         
         // Remove invisible chars
         for (int i = 0; i < uartCount; i++) {
@@ -213,24 +558,79 @@ void uartManageData() {
             }
         }
 
-        if (!strcmp(uartData, "1")) {
-            UART_PutString("Scansione colori...\n");
-            
-            /* Scan beep [START] */
-            // Start scan with a 0.5 second 10kHz beep
-            AUDIO_BeepStart();
-            TIMER2_DelayMS(500);
-            AUDIO_BeepStop();
-            /* Scan beep [END] */
-            mode = 1;
+        if (pcmUpload) {
+            pcmUploadLine();
+        } else if (calStep) {
+            calibrationStep();
+        } else if (!strcmp(uartData, "1")) {
+            startScan();
         } else if (!strcmp(uartData, "2")) {
             mode = 2;
         } else if (!strcmp(uartData, "3")) {
             mode = 3;
+        } else if (!strcmp(uartData, "4")) {
+            showLux = !showLux;
+            UART_PutString(showLux ? "Lux e CCT attivi\n" : "Lux e CCT disattivati\n");
+        } else if (!strcmp(uartData, "5")) {
+            UART_PutString("Copri il sensore e premi invio\n");
+            calStep = 1;
+        } else if (!strcmp(uartData, "6")) {
+            hdrMode = !hdrMode;
+            if (!hdrMode)
+                CLM_RestoreConfig(CLM_GetSensor(0));
+            UART_PutString(hdrMode ? "HDR attivo\n" : "HDR disattivato\n");
+        } else if (uartData[0] == '7' && (uartData[1] == 0 || uartData[1] == ' ')) {
+            i2cMeasure(uartData[1] ? atoi(uartData + 2) * 1000 : 0);
+        } else if (!strcmp(uartData, "8")) {
+            toggleRecord();
+        } else if (uartData[0] == '9' && (uartData[1] == 0 || uartData[1] == ' ')) {
+            char *end;
+            unsigned int from = uartData[1] ? strtoul(uartData + 2, &end, 10) : 0;
+            unsigned int to = uartData[1] ? strtoul(end, 0, 10) : 0;
+            CLOCK_SetProfile(clock_PROFILE_NORMAL); // SPI flash at SPIFLASH_MAX_SCK
+            LOGGER_Dump(from, to ? to : 0xFFFFFFFF);
+            CLOCK_SetProfile(clock_PROFILE_LOW);
+        } else if (uartData[0] == '1' && uartData[1] == '1' && (uartData[2] == 0 || uartData[2] == ' ')) {
+            char *end, c[30];
+            unsigned int from = uartData[2] ? strtoul(uartData + 3, &end, 10) : 0;
+            unsigned int to = uartData[2] ? strtoul(end, 0, 10) : 0;
+            CLOCK_SetProfile(clock_PROFILE_NORMAL);
+            snprintf(c, sizeof(c), "Trovati %d rossi\n", LOGGER_FindRed(from, to ? to : 0xFFFFFFFF));
+            CLOCK_SetProfile(clock_PROFILE_LOW);
+            UART_PutString(c);
+        } else if (!strcmp(uartData, "12")) {
+            sonifyMode = !sonifyMode;
+            UART_PutString(sonifyMode ? "Sonificazione attiva\n" : "Sonificazione disattivata\n");
+        } else if (!strcmp(uartData, "13")) {
+            if (!AUDIO_PcmPlayFlash(SPIFLASH_PCM_ADDR, SPIFLASH_LOG_ADDR)) {
+                UART_PutString("Riproduzione della clip in flash\n");
+            } else {
+                AUDIO_PcmPlay(soundChime, SOUND_CHIME_LENGTH, SOUND_CHIME_RATE);
+                UART_PutString("Clip in flash non trovata, riproduco il suono interno\n");
+            }
+        } else if (!strncmp(uartData, "pcm ", 4)) {
+            pcmUploadCommand();
+        } else if (!strcmp(uartData, "14")) {
+            ledMode = !ledMode;
+            UART_PutString(ledMode ? "LED colore attivo\n" : "LED colore disattivato\n");
+        } else if (!strcmp(uartData, "15")) {
+            POWER_Report();
+        } else if (!strcmp(uartData, "15 reset")) {
+            POWER_ResetStats();
+            UART_PutString("Statistiche azzerate\n");
+        } else if (!strcmp(uartData, "16")) {
+            SYSTEM_Benchmark();
+        } else if (!strcmp(uartData, "list")) {
+            SETTINGS_List();
+        } else if (!strncmp(uartData, "get ", 4) || !strncmp(uartData, "set ", 4)) {
+            settingsCommand();
+        } else if (!strcmp(uartData, "10")) {
+            LOGGER_Erase();
+            UART_PutString("Log cancellato\n");
         }
 
         clearArray(uartData, uartCount);
         uartCount = 0; // Reset index
-        waitUser = 0;
+        waitUser = calStep != 0 || pcmUpload; // Keep the menu hidden during calibration and upload
     }
 }
@@ -51,17 +51,17 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Source Files Quoted if spaced
-SOURCEFILES_QUOTED_IF_SPACED=main.c i2c.c clm.c lcd.c timer.c audio.c gpio.c uart.c spiflash.c
+SOURCEFILES_QUOTED_IF_SPACED=main.c i2c.c clm.c lcd.c timer.c audio.c gpio.c uart.c spiflash.c logger.c counter.c settings.c sounds.c power.c system.c clock.c boot.c
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/main.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/clm.o ${OBJECTDIR}/lcd.o ${OBJECTDIR}/timer.o ${OBJECTDIR}/audio.o ${OBJECTDIR}/gpio.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/spiflash.o
-POSSIBLE_DEPFILES=${OBJECTDIR}/main.o.d ${OBJECTDIR}/i2c.o.d ${OBJECTDIR}/clm.o.d ${OBJECTDIR}/lcd.o.d ${OBJECTDIR}/timer.o.d ${OBJECTDIR}/audio.o.d ${OBJECTDIR}/gpio.o.d ${OBJECTDIR}/uart.o.d ${OBJECTDIR}/spiflash.o.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/main.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/clm.o ${OBJECTDIR}/lcd.o ${OBJECTDIR}/timer.o ${OBJECTDIR}/audio.o ${OBJECTDIR}/gpio.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/spiflash.o ${OBJECTDIR}/logger.o ${OBJECTDIR}/counter.o ${OBJECTDIR}/settings.o ${OBJECTDIR}/sounds.o ${OBJECTDIR}/power.o ${OBJECTDIR}/system.o ${OBJECTDIR}/clock.o ${OBJECTDIR}/boot.o
+POSSIBLE_DEPFILES=${OBJECTDIR}/main.o.d ${OBJECTDIR}/i2c.o.d ${OBJECTDIR}/clm.o.d ${OBJECTDIR}/lcd.o.d ${OBJECTDIR}/timer.o.d ${OBJECTDIR}/audio.o.d ${OBJECTDIR}/gpio.o.d ${OBJECTDIR}/uart.o.d ${OBJECTDIR}/spiflash.o.d ${OBJECTDIR}/logger.o.d ${OBJECTDIR}/counter.o.d ${OBJECTDIR}/settings.o.d ${OBJECTDIR}/sounds.o.d ${OBJECTDIR}/power.o.d ${OBJECTDIR}/system.o.d ${OBJECTDIR}/clock.o.d ${OBJECTDIR}/boot.o.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/main.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/clm.o ${OBJECTDIR}/lcd.o ${OBJECTDIR}/timer.o ${OBJECTDIR}/audio.o ${OBJECTDIR}/gpio.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/spiflash.o
+OBJECTFILES=${OBJECTDIR}/main.o ${OBJECTDIR}/i2c.o ${OBJECTDIR}/clm.o ${OBJECTDIR}/lcd.o ${OBJECTDIR}/timer.o ${OBJECTDIR}/audio.o ${OBJECTDIR}/gpio.o ${OBJECTDIR}/uart.o ${OBJECTDIR}/spiflash.o ${OBJECTDIR}/logger.o ${OBJECTDIR}/counter.o ${OBJECTDIR}/settings.o ${OBJECTDIR}/sounds.o ${OBJECTDIR}/power.o ${OBJECTDIR}/system.o ${OBJECTDIR}/clock.o ${OBJECTDIR}/boot.o
 
 # Source Files
-SOURCEFILES=main.c i2c.c clm.c lcd.c timer.c audio.c gpio.c uart.c spiflash.c
+SOURCEFILES=main.c i2c.c clm.c lcd.c timer.c audio.c gpio.c uart.c spiflash.c logger.c counter.c settings.c sounds.c power.c system.c clock.c boot.c
 
 
 
@@ -155,6 +155,54 @@ ${OBJECTDIR}/spiflash.o: spiflash.c  .generated_files/flags/default/46452ee8025f
 	@${RM} ${OBJECTDIR}/spiflash.o 
 	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/spiflash.o.d" -o ${OBJECTDIR}/spiflash.o spiflash.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
 	
+${OBJECTDIR}/logger.o: logger.c  .generated_files/flags/default/212cc88537cff41cfeab38b04e67aa5b37378b91 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/logger.o.d 
+	@${RM} ${OBJECTDIR}/logger.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/logger.o.d" -o ${OBJECTDIR}/logger.o logger.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/counter.o: counter.c  .generated_files/flags/default/268c502ea49dca0ce027cf9c6cb73097ec32a65f .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/counter.o.d 
+	@${RM} ${OBJECTDIR}/counter.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/counter.o.d" -o ${OBJECTDIR}/counter.o counter.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/settings.o: settings.c  .generated_files/flags/default/aa79dfcbf75da010e9fde9ced37c5bf900d4956a .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/settings.o.d 
+	@${RM} ${OBJECTDIR}/settings.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/settings.o.d" -o ${OBJECTDIR}/settings.o settings.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/sounds.o: sounds.c  .generated_files/flags/default/391f3fbf3fb58fa9aa811cfd45d89125f64122a6 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sounds.o.d 
+	@${RM} ${OBJECTDIR}/sounds.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/sounds.o.d" -o ${OBJECTDIR}/sounds.o sounds.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/power.o: power.c  .generated_files/flags/default/471557051b0605e37726043ef93d3bb865288a2d .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/power.o.d 
+	@${RM} ${OBJECTDIR}/power.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/power.o.d" -o ${OBJECTDIR}/power.o power.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/system.o: system.c  .generated_files/flags/default/cd55e1a04e00282f4c4dceb8d7b8c8f180047584 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/system.o.d 
+	@${RM} ${OBJECTDIR}/system.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/system.o.d" -o ${OBJECTDIR}/system.o system.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/clock.o: clock.c  .generated_files/flags/default/8c0c07b9728c0de2088eb4dc656ac513068a3ca5 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/clock.o.d 
+	@${RM} ${OBJECTDIR}/clock.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/clock.o.d" -o ${OBJECTDIR}/clock.o clock.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/boot.o: boot.c  .generated_files/flags/default/59851ae84a5d069436df3f5f4b1da4c0927c2d55 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/boot.o.d 
+	@${RM} ${OBJECTDIR}/boot.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE) -g -D__DEBUG -D__MPLAB_DEBUGGER_PK3=1  -fframe-base-loclist  -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/boot.o.d" -o ${OBJECTDIR}/boot.o boot.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
 else
 ${OBJECTDIR}/main.o: main.c  .generated_files/flags/default/1da0530bfc3e322b485cd0c5a2323eb5505bee0e .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
 	@${MKDIR} "${OBJECTDIR}" 
@@ -210,6 +258,54 @@ ${OBJECTDIR}/spiflash.o: spiflash.c  .generated_files/flags/default/62b40cffd317
 	@${RM} ${OBJECTDIR}/spiflash.o 
 	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/spiflash.o.d" -o ${OBJECTDIR}/spiflash.o spiflash.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
 	
+${OBJECTDIR}/logger.o: logger.c  .generated_files/flags/default/54667d75d7d189bdb674303622739682e83056fb .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/logger.o.d 
+	@${RM} ${OBJECTDIR}/logger.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/logger.o.d" -o ${OBJECTDIR}/logger.o logger.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/counter.o: counter.c  .generated_files/flags/default/f705088d26796b306b1614d8e15a5f1f26341803 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/counter.o.d 
+	@${RM} ${OBJECTDIR}/counter.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/counter.o.d" -o ${OBJECTDIR}/counter.o counter.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/settings.o: settings.c  .generated_files/flags/default/39c6fea090540835667e8f8625df9ef0704919e9 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/settings.o.d 
+	@${RM} ${OBJECTDIR}/settings.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/settings.o.d" -o ${OBJECTDIR}/settings.o settings.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/sounds.o: sounds.c  .generated_files/flags/default/02e058506c0aa6d42a23a334b7913f03917bae37 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/sounds.o.d 
+	@${RM} ${OBJECTDIR}/sounds.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/sounds.o.d" -o ${OBJECTDIR}/sounds.o sounds.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/power.o: power.c  .generated_files/flags/default/f4a3dfd825610e3834c2917872facd29a9f6bf2d .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/power.o.d 
+	@${RM} ${OBJECTDIR}/power.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/power.o.d" -o ${OBJECTDIR}/power.o power.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/system.o: system.c  .generated_files/flags/default/61bb489c56e4a871f38c613ab702ac2b915f0cc4 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/system.o.d 
+	@${RM} ${OBJECTDIR}/system.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/system.o.d" -o ${OBJECTDIR}/system.o system.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/clock.o: clock.c  .generated_files/flags/default/5dffc98c7f3516be45f4c3dd9aaeb93e93c8d9ac .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/clock.o.d 
+	@${RM} ${OBJECTDIR}/clock.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/clock.o.d" -o ${OBJECTDIR}/clock.o clock.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
+${OBJECTDIR}/boot.o: boot.c  .generated_files/flags/default/0b1980b5c5240d0a4b5bfb7c85473665b252fcf9 .generated_files/flags/default/da39a3ee5e6b4b0d3255bfef95601890afd80709
+	@${MKDIR} "${OBJECTDIR}" 
+	@${RM} ${OBJECTDIR}/boot.o.d 
+	@${RM} ${OBJECTDIR}/boot.o 
+	${MP_CC}  $(MP_EXTRA_CC_PRE)  -g -x c -c -mprocessor=$(MP_PROCESSOR_OPTION)  -fno-common -MP -MMD -MF "${OBJECTDIR}/boot.o.d" -o ${OBJECTDIR}/boot.o boot.c    -DXPRJ_default=$(CND_CONF)    $(COMPARISON_BUILD)  -mdfp="${DFP_DIR}"  
+	
 endif
 
 # ------------------------------------------------------------------------------------
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include "clock.h"
+#include "power.h"
+#include "timer.h"
+#include "uart.h"
+#include <p32xxxx.h>
+
+power_Stats powerStats[POWER_MODES];
+unsigned int powerLast; // core timer at the previous POWER_Idle
+
+/***	POWER_Init
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function selects Idle mode for the WAIT instruction and turns off the peripherals that
+**      are never used, so they draw no current.
+**      
+**          
+*/
+void POWER_Init() {
+    // OSCCON and the PMD lock are protected: unlock sequence
+    SYSKEY = 0;
+    SYSKEY = 0xAA996655;
+    SYSKEY = 0x556699AA;
+    OSCCONbits.SLPEN = 0; // WAIT enters Idle, not Sleep: the peripherals keep their clock
+    CFGCONbits.PMDLOCK = 0;
+    POWER_DisableModules();
+    CFGCONbits.PMDLOCK = 1;
+    SYSKEY = 0;
+    
+    POWER_ResetStats();
+}
+
+/***	POWER_DisableModules
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function disables the modules not used by the colorimeter. Used: UART4, I2C1, SPI1,
+**      OC1 (audio), OC3-OC5 (LED), Timer2-Timer4, PMP (LCD) and DMA.
+**      
+**          
+*/
+void POWER_DisableModules() {
+    PMD1bits.AD1MD = 1; // ADC
+    PMD1bits.CTMUMD = 1;
+    PMD1bits.CVRMD = 1; // Comparator voltage reference
+    PMD2bits.CMP1MD = 1;
+    PMD2bits.CMP2MD = 1;
+    PMD3bits.IC1MD = 1;
+    PMD3bits.IC2MD = 1;
+    PMD3bits.IC3MD = 1;
+    PMD3bits.IC4MD = 1;
+    PMD3bits.IC5MD = 1;
+    PMD3bits.OC2MD = 1;
+    PMD4bits.T1MD = 1;
+    PMD4bits.T5MD = 1;
+    PMD5bits.U1MD = 1;
+    PMD5bits.U2MD = 1;
+    PMD5bits.U3MD = 1;
+    PMD5bits.U5MD = 1;
+    PMD5bits.SPI2MD = 1;
+    PMD5bits.I2C2MD = 1;
+    PMD6bits.RTCCMD = 1;
+    PMD6bits.REFOMD = 1;
+}
+
+/***	POWER_Idle
+**
+**	Parameters:
+**      int mode - Current main loop mode, for the statistics.
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function stops the CPU until the next interrupt. An interrupt arriving between the last
+**      check of the main loop and the WAIT is served at the following tick, at most 1 ms later.
+**      
+**          
+*/
+void POWER_Idle(int mode) {
+    unsigned int start = TIMER_GetCoreTicks();
+    
+    asm volatile("wait");
+    
+    unsigned int now = TIMER_GetCoreTicks();
+    if (mode >= 0 && mode < POWER_MODES) {
+        powerStats[mode].total += now - powerLast;
+        powerStats[mode].idle += now - start;
+    }
+    powerLast = now;
+}
+
+/***	POWER_Report
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function prints, for the menu and scan modes, the share of time the CPU was running
+**      since the last reset of the statistics and the resulting current estimate, then the current
+**      peripheral bus clock.
+**      
+**          
+*/
+void POWER_Report() {
+    static const char *names[2] = {"Menu", "Scansione"};
+    char uartPrint[70];
+    
+    for (int i = 0; i < 2; i++) {
+        power_Stats *stats = &powerStats[i];
+        if (stats->total == 0)
+            continue;
+        
+        unsigned int active = (stats->total - stats->idle) * 1000 / stats->total; // per mille
+        unsigned int ma10 = POWER_IDLE_MA * 10 + (POWER_RUN_MA - POWER_IDLE_MA) * active / 100;
+        snprintf(uartPrint, sizeof(uartPrint), "%s: CPU attiva %u.%u%%, ~%u.%u mA (%u s)\n", names[i],
+                active / 10, active % 10, ma10 / 10, ma10 % 10, (unsigned int) (stats->total / (CORE_TICKS_PER_MS * 1000)));
+        UART_PutString(uartPrint);
+    }
+    snprintf(uartPrint, sizeof(uartPrint), "Clock periferiche: %u MHz\n", CLOCK_GetPB() / 1000000);
+    UART_PutString(uartPrint);
+}
+
+/***	POWER_ResetStats
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function clears the statistics of all modes.
+**      
+**          
+*/
+void POWER_ResetStats() {
+    memset(powerStats, 0, sizeof(powerStats));
+    powerLast = TIMER_GetCoreTicks();
+}
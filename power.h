@@ -0,0 +1,42 @@
+/*
+ * File:   power.h
+ * @brief Header file for the power management.
+ *
+ * This file contains the definitions and function prototypes for idling the CPU between events and
+ * estimating the current draw of each operating mode.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef POWER_H
+#define	POWER_H
+
+#include "config.h"
+
+/*
+ * The main loop calls POWER_Idle when it has nothing to do: WAIT stops the CPU (Idle mode, SLPEN = 0)
+ * while the peripherals keep running, and any interrupt wakes it up. The 1 ms Timer2 tick is always
+ * enabled, so the polled work (I2C timeouts, scan schedule, flash busy, button debounce) is delayed
+ * by less than 1 ms.
+ */
+#define POWER_MODES 4 // main loop modes (main.c mode)
+
+/* current estimate: typical PIC32MX370 values at SYS_CLK 80 MHz (datasheet IDD and IIDLE), board excluded */
+#define POWER_RUN_MA 32
+#define POWER_IDLE_MA 14
+
+typedef struct {
+    unsigned long long total; // core timer ticks spent in the mode (it keeps counting in Idle)
+    unsigned long long idle; // of which in Idle mode
+} power_Stats;
+
+/* public functions */
+void POWER_Init();
+void POWER_Idle(int mode);
+void POWER_Report();
+void POWER_ResetStats();
+
+/* private functions */
+void POWER_DisableModules();
+
+#endif	/* POWER_H */
@@ -0,0 +1,282 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "settings.h"
+#include "spiflash.h"
+#include "uart.h"
+
+const unsigned int settingsGains[] = {1, 4, 16, 60, 0}; // AGAIN of the TCS34725
+const unsigned int settingsBauds[] = {1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 0};
+
+const settings_Key settingsKeys[settings_COUNT] = {
+    {"itime", 100, 3, 614, 0}, // ATIME = 256 - itime / 2.4
+    {"gain", 4, 1, 60, settingsGains},
+    {"red", 100, 1, 1000, 0},
+    {"baud", 9600, 1200, 921600, settingsBauds}, // Standard rates only, the terminal must be able to follow
+    {"beep", 10000, 1000, 20000, 0},
+    {"beepms", 500, 0, 5000, 0},
+    {"wait", 0, 0, 614, 0} // WTIME = 256 - wait / 2.4
+};
+
+unsigned int settingsValues[settings_COUNT]; // RAM cache
+int settingsCopy = 1; // copy holding the current values
+unsigned int settingsSequence = 0;
+
+/***	SETTINGS_Init
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function loads the newest valid copy of the settings into the RAM cache.
+**      Keys missing from the flash (or not accepted by SETTINGS_IsValid) keep their default value.
+**      It must be called after SPIFLASH_Init and before the modules that use the settings.
+**      
+**          
+*/
+void SETTINGS_Init() {
+    settings_Block block[2];
+    int valid[2];
+    
+    for (int i = 0; i < settings_COUNT; i++)
+        settingsValues[i] = settingsKeys[i].value;
+    
+    for (int i = 0; i < 2; i++)
+        valid[i] = SETTINGS_Load(i, &block[i]) == 0;
+    
+    if (!valid[0] && !valid[1])
+        return; // Defaults, the first save goes to copy 0
+    
+    // The sequence is compared as a difference so it can wrap around
+    settingsCopy = !valid[0] || (valid[1] && (int) (block[1].sequence - block[0].sequence) > 0);
+    settingsSequence = block[settingsCopy].sequence;
+    
+    for (int i = 0; i < block[settingsCopy].count; i++) {
+        settings_Entry *entry = &block[settingsCopy].entries[i];
+        if (SETTINGS_IsValid(entry->key, entry->value))
+            settingsValues[entry->key] = entry->value;
+    }
+}
+
+/***	SETTINGS_Get
+**
+**	Parameters:
+**      int key - settings_x key.
+**
+**	Return Value:
+**      unsigned int - Value of the setting.
+**
+**	Description:
+**		This function returns a setting from the RAM cache (no flash access).
+**      
+**          
+*/
+unsigned int SETTINGS_Get(int key) {
+    return settingsValues[key];
+}
+
+/***	SETTINGS_Set
+**
+**	Parameters:
+**      int key - settings_x key.
+**      unsigned int value - New value.
+**
+**	Return Value:
+**      int - 0 if stored, -1 if the value is not accepted, -2 if the flash write failed.
+**
+**	Description:
+**		This function changes a setting and saves all the settings in flash.
+**      If the save fails the previous value is restored, so the caller applies the new value
+**      only when 0 is returned and the RAM cache always matches the flash.
+**      
+**          
+*/
+int SETTINGS_Set(int key, unsigned int value) {
+    if (!SETTINGS_IsValid(key, value))
+        return -1;
+    
+    unsigned int previous = settingsValues[key];
+    settingsValues[key] = value;
+    if (SETTINGS_Save()) {
+        settingsValues[key] = previous;
+        return -2;
+    }
+    return 0;
+}
+
+/***	SETTINGS_IsValid
+**
+**	Parameters:
+**      int key - settings_x key.
+**      unsigned int value - Value to be checked.
+**
+**	Return Value:
+**      int - 1 if the value is accepted by the setting.
+**
+**	Description:
+**		This function checks a value against the range of the setting and, when the setting has one,
+**      against its list of accepted values (e.g. the gains of the sensor, the standard baud rates).
+**      
+**          
+*/
+int SETTINGS_IsValid(int key, unsigned int value) {
+    if (key < 0 || key >= settings_COUNT || value < settingsKeys[key].min || value > settingsKeys[key].max)
+        return 0;
+    if (!settingsKeys[key].allowed)
+        return 1;
+    
+    for (const unsigned int *allowed = settingsKeys[key].allowed; *allowed; allowed++) {
+        if (*allowed == value)
+            return 1;
+    }
+    return 0;
+}
+
+/***	SETTINGS_FormatRange
+**
+**	Parameters:
+**      int key - settings_x key.
+**      char *buf - Receives the text.
+**      int size - Size of buf.
+**
+**	Return Value:
+**
+**	Description:
+**		This function writes the accepted values of a setting: "min..max" or the list of values.
+**      
+**          
+*/
+void SETTINGS_FormatRange(int key, char *buf, int size) {
+    const unsigned int *allowed = settingsKeys[key].allowed;
+    int len = 0;
+    
+    if (!allowed) {
+        snprintf(buf, size, "%u..%u", settingsKeys[key].min, settingsKeys[key].max);
+        return;
+    }
+    
+    buf[0] = 0;
+    for (; *allowed && len < size; allowed++)
+        len += snprintf(buf + len, size - len, len ? ", %u" : "%u", *allowed);
+}
+
+/***	SETTINGS_Find
+**
+**	Parameters:
+**      const char *name - Name of a setting.
+**
+**	Return Value:
+**      int - settings_x key, -1 if unknown.
+**
+**	Description:
+**		This function looks up a setting by name.
+**      
+**          
+*/
+int SETTINGS_Find(const char *name) {
+    for (int i = 0; i < settings_COUNT; i++) {
+        if (!strcmp(settingsKeys[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+/***	SETTINGS_GetKey
+**
+**	Parameters:
+**      int key - settings_x key.
+**
+**	Return Value:
+**      const settings_Key * - Name, default and range of the setting.
+**
+**	Description:
+**		This function returns the description of a setting.
+**      
+**          
+*/
+const settings_Key *SETTINGS_GetKey(int key) {
+    return &settingsKeys[key];
+}
+
+/***	SETTINGS_List
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function prints all the settings with their range over UART.
+**      
+**          
+*/
+void SETTINGS_List() {
+    char c[30], range[100];
+    
+    for (int i = 0; i < settings_COUNT; i++) {
+        snprintf(c, sizeof(c), "%s = %u (", settingsKeys[i].name, settingsValues[i]);
+        UART_PutString(c);
+        SETTINGS_FormatRange(i, range, sizeof(range));
+        UART_PutString(range);
+        UART_PutString(")\n");
+    }
+}
+
+/***	SETTINGS_Load
+**
+**	Parameters:
+**      int copy - Copy to be read (0 or 1).
+**      settings_Block *block - Block read from the flash.
+**
+**	Return Value:
+**      int - 0 if the copy is valid, -1 otherwise.
+**
+**	Description:
+**		This function reads a copy of the settings and checks its magic and CRC.
+**      
+**          
+*/
+int SETTINGS_Load(int copy, settings_Block *block) {
+    SPIFLASH_Read(SPIFLASH_SETTINGS_ADDR + copy * SPIFLASH_SECTOR_SIZE, (unsigned char *) block, sizeof(settings_Block));
+    
+    if (block->magic != settings_MAGIC || block->count > settings_MAX_ENTRIES ||
+            block->crc != SPIFLASH_CRC16(0xFFFF, (unsigned char *) block, offsetof(settings_Block, crc)))
+        return -1;
+    return 0;
+}
+
+/***	SETTINGS_Save
+**
+**	Parameters:
+**
+**	Return Value:
+**      int - 0 if saved, -1 if the verify failed.
+**
+**	Description:
+**		This function writes the RAM cache over the older copy and verifies it. The current copy
+**      is changed only after the check, so a failed save keeps the last good one.
+**      
+**          
+*/
+int SETTINGS_Save() {
+    settings_Block block;
+    int copy = !settingsCopy;
+    
+    memset(&block, 0xFF, sizeof(block));
+    block.magic = settings_MAGIC;
+    block.count = settings_COUNT;
+    block.sequence = settingsSequence + 1;
+    for (int i = 0; i < settings_COUNT; i++) {
+        block.entries[i].key = i;
+        block.entries[i].value = settingsValues[i];
+    }
+    block.crc = SPIFLASH_CRC16(0xFFFF, (unsigned char *) &block, offsetof(settings_Block, crc));
+    
+    SPIFLASH_EraseSector(SPIFLASH_SETTINGS_ADDR + copy * SPIFLASH_SECTOR_SIZE);
+    if (SPIFLASH_ProgramVerify(SPIFLASH_SETTINGS_ADDR + copy * SPIFLASH_SECTOR_SIZE, (unsigned char *) &block, sizeof(block)))
+        return -1;
+    
+    settingsCopy = copy;
+    settingsSequence = block.sequence;
+    return 0;
+}
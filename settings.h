@@ -0,0 +1,67 @@
+/*
+ * File:   settings.h
+ * @brief Header file for the settings store.
+ *
+ * This file contains the definitions and function prototypes for the operating parameters kept in SPI flash
+ * as key-value pairs and cached in RAM.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef SETTINGS_H
+#define	SETTINGS_H
+
+#include "config.h"
+
+/* keys (the numbers are stored in flash, never reuse one) */
+#define settings_ITIME 0 // integration time (ms)
+#define settings_GAIN 1 // analog gain (1, 4, 16 or 60)
+#define settings_RED 2 // red threshold: r / (g + b) in percent
+#define settings_BAUD 3 // UART baud rate (applied at boot)
+#define settings_BEEP 4 // beep frequency (Hz)
+#define settings_BEEP_MS 5 // beep length at the start of the scan (ms)
+#define settings_WAIT 6 // sensor wait time between integrations (ms, 0 = continuous)
+#define settings_COUNT 7
+
+/*
+ * Two copies at SPIFLASH_SETTINGS_ADDR, one per sector. A save erases and programs the older copy with
+ * a higher sequence number, so a reset during the save leaves the previous copy valid.
+ */
+#define settings_MAGIC 0x5E77
+#define settings_MAX_ENTRIES 16
+
+typedef struct {
+    const char *name; // name used by the terminal commands
+    unsigned int value; // default value
+    unsigned int min, max; // accepted range
+    const unsigned int *allowed; // accepted values (0 terminated), 0 if the whole range is accepted
+} settings_Key;
+
+typedef struct {
+    unsigned int key; // settings_x
+    unsigned int value;
+} settings_Entry;
+
+typedef struct {
+    unsigned short magic; // settings_MAGIC
+    unsigned short count; // entries used
+    unsigned int sequence; // incremented at every save
+    settings_Entry entries[settings_MAX_ENTRIES];
+    unsigned short crc; // SPIFLASH_CRC16 of the fields above
+} settings_Block;
+
+/* public functions */
+void SETTINGS_Init();
+unsigned int SETTINGS_Get(int key);
+int SETTINGS_Set(int key, unsigned int value);
+int SETTINGS_Find(const char *name);
+const settings_Key *SETTINGS_GetKey(int key);
+int SETTINGS_IsValid(int key, unsigned int value);
+void SETTINGS_FormatRange(int key, char *buf, int size);
+void SETTINGS_List();
+
+/* private functions */
+int SETTINGS_Load(int copy, settings_Block *block);
+int SETTINGS_Save();
+
+#endif	/* SETTINGS_H */
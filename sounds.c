@@ -0,0 +1,105 @@
+#include "sounds.h"
+
+/* Two plucked notes (1318.5 Hz for 80 ms, 1760 Hz for 120 ms) with an exponential decay */
+const unsigned char soundChime[SOUND_CHIME_LENGTH] = {
+    0x80, 0x86, 0x8C, 0x81, 0x69, 0x62, 0x7D, 0xA7, 0xB1, 0x86, 0x4A, 0x3C, 0x75, 0xC4, 0xD7, 0x91,
+    0x30, 0x1C, 0x6A, 0xCD, 0xE5, 0x99, 0x36, 0x1B, 0x63, 0xC7, 0xE5, 0xA0, 0x3C, 0x1B, 0x5D, 0xC1,
+    0xE5, 0xA6, 0x42, 0x1B, 0x57, 0xBA, 0xE5, 0xAC, 0x49, 0x1C, 0x51, 0xB4, 0xE4, 0xB2, 0x4F, 0x1D,
+    0x4C, 0xAD, 0xE2, 0xB7, 0x56, 0x1F, 0x47, 0xA6, 0xE0, 0xBC, 0x5D, 0x21, 0x42, 0xA0, 0xDE, 0xC0,
+    0x64, 0x24, 0x3E, 0x99, 0xDB, 0xC4, 0x6A, 0x27, 0x3A, 0x92, 0xD8, 0xC7, 0x71, 0x2A, 0x37, 0x8C,
+    0xD4, 0xCA, 0x78, 0x2E, 0x34, 0x85, 0xD0, 0xCD, 0x7E, 0x32, 0x32, 0x7F, 0xCC, 0xCF, 0x84, 0x36,
+    0x30, 0x79, 0xC8, 0xD0, 0x8A, 0x3A, 0x2F, 0x73, 0xC3, 0xD2, 0x90, 0x3F, 0x2E, 0x6D, 0xBE, 0xD2,
+    0x96, 0x44, 0x2D, 0x68, 0xB9, 0xD3, 0x9B, 0x49, 0x2D, 0x62, 0xB4, 0xD3, 0xA0, 0x4F, 0x2E, 0x5D,
+    0xAF, 0xD2, 0xA5, 0x54, 0x2E, 0x59, 0xA9, 0xD1, 0xA9, 0x59, 0x2F, 0x54, 0xA4, 0xD0, 0xAE, 0x5F,
+    0x31, 0x50, 0x9E, 0xCE, 0xB1, 0x64, 0x33, 0x4D, 0x99, 0xCC, 0xB5, 0x6A, 0x35, 0x4A, 0x93, 0xCA,
+    0xB8, 0x6F, 0x37, 0x47, 0x8E, 0xC7, 0xBB, 0x75, 0x3A, 0x44, 0x89, 0xC4, 0xBD, 0x7A, 0x3D, 0x42,
+    0x83, 0xC1, 0xBF, 0x7F, 0x41, 0x40, 0x7E, 0xBE, 0xC1, 0x84, 0x44, 0x3F, 0x79, 0xBA, 0xC2, 0x89,
+    0x48, 0x3E, 0x74, 0xB6, 0xC3, 0x8E, 0x4C, 0x3D, 0x70, 0xB2, 0xC3, 0x93, 0x50, 0x3C, 0x6B, 0xAE,
+    0xC4, 0x97, 0x54, 0x3C, 0x67, 0xAA, 0xC3, 0x9B, 0x58, 0x3D, 0x63, 0xA5, 0xC3, 0x9F, 0x5D, 0x3D,
+    0x5F, 0xA1, 0xC2, 0xA3, 0x61, 0x3E, 0x5C, 0x9C, 0xC1, 0xA6, 0x66, 0x40, 0x59, 0x98, 0xC0, 0xA9,
+    0x6A, 0x41, 0x56, 0x93, 0xBE, 0xAC, 0x6F, 0x43, 0x53, 0x8F, 0xBC, 0xAE, 0x73, 0x45, 0x51, 0x8B,
+    0xBA, 0xB0, 0x78, 0x47, 0x4F, 0x86, 0xB7, 0xB2, 0x7C, 0x4A, 0x4D, 0x82, 0xB5, 0xB4, 0x80, 0x4D,
+    0x4C, 0x7E, 0xB2, 0xB5, 0x84, 0x50, 0x4A, 0x7A, 0xAF, 0xB6, 0x88, 0x53, 0x4A, 0x76, 0xAC, 0xB7,
+    0x8C, 0x56, 0x49, 0x72, 0xA8, 0xB7, 0x90, 0x59, 0x49, 0x6E, 0xA5, 0xB7, 0x93, 0x5D, 0x49, 0x6B,
+    0xA1, 0xB7, 0x97, 0x60, 0x49, 0x68, 0x9E, 0xB7, 0x9A, 0x64, 0x4A, 0x65, 0x9A, 0xB6, 0x9D, 0x68,
+    0x4B, 0x62, 0x97, 0xB5, 0x9F, 0x6B, 0x4C, 0x5F, 0x93, 0xB4, 0xA2, 0x6F, 0x4D, 0x5D, 0x8F, 0xB2,
+    0xA4, 0x73, 0x4E, 0x5B, 0x8C, 0xB1, 0xA6, 0x76, 0x50, 0x59, 0x88, 0xAF, 0xA8, 0x7A, 0x52, 0x57,
+    0x84, 0xAD, 0xA9, 0x7D, 0x54, 0x56, 0x81, 0xAB, 0xAB, 0x81, 0x57, 0x55, 0x7D, 0xA8, 0xAC, 0x84,
+    0x59, 0x54, 0x7A, 0xA6, 0xAC, 0x87, 0x5B, 0x53, 0x77, 0xA3, 0xAD, 0x8B, 0x5E, 0x53, 0x74, 0xA0,
+    0xAD, 0x8E, 0x61, 0x53, 0x71, 0x9E, 0xAD, 0x90, 0x64, 0x53, 0x6E, 0x9B, 0xAD, 0x93, 0x67, 0x53,
+    0x6C, 0x98, 0xAD, 0x96, 0x6A, 0x54, 0x69, 0x95, 0xAC, 0x98, 0x6D, 0x54, 0x67, 0x92, 0xAB, 0x9A,
+    0x70, 0x55, 0x65, 0x8F, 0xAA, 0x9C, 0x73, 0x57, 0x63, 0x8C, 0xA9, 0x9E, 0x76, 0x58, 0x61, 0x89,
+    0xA7, 0x9F, 0x79, 0x59, 0x60, 0x86, 0xA6, 0xA1, 0x7C, 0x5B, 0x5F, 0x83, 0xA4, 0xA2, 0x7E, 0x5D,
+    0x5E, 0x80, 0xA2, 0xA3, 0x81, 0x5E, 0x5D, 0x7D, 0xA1, 0xA4, 0x84, 0x60, 0x5C, 0x7B, 0x9E, 0xA4,
+    0x87, 0x63, 0x5C, 0x78, 0x9C, 0xA5, 0x89, 0x65, 0x5B, 0x76, 0x9A, 0xA5, 0x8B, 0x67, 0x5B, 0x73,
+    0x98, 0xA5, 0x8E, 0x69, 0x5B, 0x71, 0x95, 0xA5, 0x90, 0x6C, 0x5C, 0x6F, 0x93, 0xA4, 0x92, 0x6E,
+    0x5C, 0x6D, 0x91, 0xA4, 0x94, 0x71, 0x5D, 0x6B, 0x8E, 0xA3, 0x96, 0x73, 0x5D, 0x6A, 0x8C, 0xA2,
+    0x97, 0x76, 0x5E, 0x68, 0x89, 0xA1, 0x99, 0x78, 0x5F, 0x67, 0x87, 0xA0, 0x9A, 0x7A, 0x61, 0x66,
+    0x84, 0x9F, 0x9B, 0x7D, 0x62, 0x65, 0x82, 0x9D, 0x9C, 0x7F, 0x63, 0x64, 0x80, 0x9C, 0x9D, 0x81,
+    0x65, 0x63, 0x7D, 0x9A, 0x9D, 0x84, 0x67, 0x63, 0x7B, 0x99, 0x9E, 0x86, 0x68, 0x62, 0x79, 0x97,
+    0x9E, 0x88, 0x6A, 0x62, 0x77, 0x95, 0x9E, 0x8A, 0x6C, 0x62, 0x75, 0x93, 0x9E, 0x8C, 0x6E, 0x62,
+    0x74, 0x91, 0x9E, 0x8D, 0x70, 0x62, 0x72, 0x8F, 0x9E, 0x8F, 0x72, 0x63, 0x70, 0x8D, 0x9D, 0x90,
+    0x74, 0x63, 0x6F, 0x8B, 0x9D, 0x92, 0x76, 0x64, 0x6D, 0x89, 0x9C, 0x93, 0x78, 0x65, 0x6C, 0x87,
+    0x9B, 0x94, 0x7A, 0x66, 0x6B, 0x85, 0x9A, 0x95, 0x7C, 0x67, 0x6A, 0x83, 0x99, 0x96, 0x7E, 0x68,
+    0x69, 0x81, 0x98, 0x97, 0x80, 0x69, 0x69, 0x7F, 0x97, 0x97, 0x81, 0x6A, 0x68, 0x7E, 0x95, 0x98,
+    0x80, 0x87, 0x85, 0x6F, 0x6D, 0x94, 0xA5, 0x74, 0x4A, 0x78, 0xC0, 0xA4, 0x42, 0x3D, 0xAD, 0xDF,
+    0x73, 0x16, 0x66, 0xDF, 0xBE, 0x38, 0x28, 0xA6, 0xE6, 0x80, 0x1A, 0x5A, 0xD7, 0xC7, 0x44, 0x23,
+    0x99, 0xE6, 0x8D, 0x1F, 0x4F, 0xCE, 0xCE, 0x4F, 0x20, 0x8D, 0xE4, 0x99, 0x26, 0x46, 0xC4, 0xD4,
+    0x5C, 0x1F, 0x80, 0xE0, 0xA4, 0x2E, 0x3D, 0xB9, 0xD8, 0x68, 0x20, 0x74, 0xDB, 0xAE, 0x36, 0x36,
+    0xAE, 0xDA, 0x74, 0x22, 0x69, 0xD5, 0xB7, 0x40, 0x31, 0xA2, 0xDB, 0x80, 0x25, 0x5E, 0xCE, 0xBF,
+    0x4A, 0x2D, 0x97, 0xDB, 0x8B, 0x2A, 0x54, 0xC6, 0xC6, 0x55, 0x2B, 0x8B, 0xD9, 0x96, 0x2F, 0x4C,
+    0xBD, 0xCB, 0x60, 0x2A, 0x80, 0xD6, 0xA0, 0x36, 0x44, 0xB3, 0xCE, 0x6A, 0x2A, 0x75, 0xD2, 0xA9,
+    0x3E, 0x3E, 0xA9, 0xD1, 0x75, 0x2C, 0x6B, 0xCC, 0xB1, 0x47, 0x39, 0x9F, 0xD2, 0x80, 0x2F, 0x62,
+    0xC6, 0xB8, 0x50, 0x36, 0x94, 0xD1, 0x8A, 0x33, 0x59, 0xBE, 0xBE, 0x59, 0x34, 0x8A, 0xD0, 0x94,
+    0x38, 0x51, 0xB6, 0xC3, 0x63, 0x33, 0x80, 0xCD, 0x9D, 0x3E, 0x4B, 0xAE, 0xC6, 0x6D, 0x33, 0x76,
+    0xC9, 0xA5, 0x45, 0x45, 0xA5, 0xC8, 0x77, 0x35, 0x6D, 0xC4, 0xAC, 0x4D, 0x41, 0x9B, 0xC9, 0x80,
+    0x37, 0x65, 0xBE, 0xB2, 0x55, 0x3E, 0x92, 0xC9, 0x89, 0x3B, 0x5D, 0xB8, 0xB8, 0x5D, 0x3C, 0x89,
+    0xC7, 0x92, 0x40, 0x56, 0xB0, 0xBC, 0x66, 0x3B, 0x80, 0xC5, 0x9A, 0x45, 0x50, 0xA9, 0xBF, 0x6F,
+    0x3B, 0x77, 0xC1, 0xA1, 0x4B, 0x4C, 0xA1, 0xC0, 0x78, 0x3D, 0x6F, 0xBD, 0xA7, 0x52, 0x48, 0x99,
+    0xC1, 0x80, 0x3F, 0x68, 0xB8, 0xAD, 0x59, 0x45, 0x90, 0xC1, 0x88, 0x42, 0x61, 0xB2, 0xB2, 0x61,
+    0x43, 0x88, 0xC0, 0x90, 0x47, 0x5B, 0xAB, 0xB5, 0x69, 0x42, 0x80, 0xBD, 0x97, 0x4B, 0x55, 0xA4,
+    0xB8, 0x71, 0x43, 0x78, 0xBA, 0x9D, 0x51, 0x51, 0x9D, 0xBA, 0x78, 0x44, 0x71, 0xB6, 0xA3, 0x57,
+    0x4E, 0x96, 0xBA, 0x80, 0x46, 0x6A, 0xB2, 0xA8, 0x5E, 0x4B, 0x8F, 0xBA, 0x87, 0x49, 0x64, 0xAC,
+    0xAC, 0x64, 0x4A, 0x87, 0xB9, 0x8E, 0x4D, 0x5F, 0xA7, 0xB0, 0x6B, 0x49, 0x80, 0xB7, 0x95, 0x51,
+    0x5A, 0xA1, 0xB2, 0x72, 0x49, 0x79, 0xB4, 0x9A, 0x56, 0x56, 0x9A, 0xB3, 0x79, 0x4A, 0x73, 0xB1,
+    0x9F, 0x5B, 0x53, 0x94, 0xB4, 0x80, 0x4C, 0x6D, 0xAC, 0xA4, 0x61, 0x51, 0x8D, 0xB4, 0x87, 0x4F,
+    0x67, 0xA8, 0xA8, 0x67, 0x4F, 0x86, 0xB3, 0x8D, 0x52, 0x62, 0xA3, 0xAB, 0x6D, 0x4F, 0x80, 0xB1,
+    0x92, 0x56, 0x5E, 0x9D, 0xAD, 0x74, 0x4F, 0x7A, 0xAF, 0x98, 0x5A, 0x5B, 0x97, 0xAE, 0x7A, 0x50,
+    0x74, 0xAB, 0x9C, 0x5F, 0x58, 0x91, 0xAF, 0x80, 0x52, 0x6F, 0xA8, 0xA0, 0x65, 0x56, 0x8C, 0xAE,
+    0x86, 0x54, 0x6A, 0xA3, 0xA3, 0x6A, 0x54, 0x86, 0xAD, 0x8B, 0x57, 0x65, 0x9F, 0xA6, 0x6F, 0x54,
+    0x80, 0xAC, 0x90, 0x5A, 0x62, 0x9A, 0xA8, 0x75, 0x54, 0x7B, 0xAA, 0x95, 0x5E, 0x5F, 0x95, 0xA9,
+    0x7B, 0x55, 0x75, 0xA7, 0x99, 0x63, 0x5C, 0x90, 0xAA, 0x80, 0x57, 0x71, 0xA3, 0x9D, 0x67, 0x5A,
+    0x8A, 0xA9, 0x85, 0x59, 0x6C, 0xA0, 0xA0, 0x6C, 0x59, 0x85, 0xA9, 0x8A, 0x5B, 0x68, 0x9C, 0xA2,
+    0x71, 0x59, 0x80, 0xA7, 0x8F, 0x5E, 0x65, 0x97, 0xA4, 0x76, 0x59, 0x7B, 0xA5, 0x93, 0x62, 0x62,
+    0x93, 0xA5, 0x7B, 0x5A, 0x76, 0xA3, 0x96, 0x66, 0x60, 0x8E, 0xA5, 0x80, 0x5B, 0x72, 0xA0, 0x9A,
+    0x6A, 0x5E, 0x89, 0xA5, 0x85, 0x5D, 0x6E, 0x9C, 0x9C, 0x6E, 0x5D, 0x85, 0xA4, 0x89, 0x5F, 0x6B,
+    0x99, 0x9E, 0x73, 0x5D, 0x80, 0xA3, 0x8D, 0x62, 0x68, 0x95, 0xA0, 0x77, 0x5D, 0x7C, 0xA1, 0x91,
+    0x65, 0x65, 0x91, 0xA1, 0x7C, 0x5E, 0x77, 0x9F, 0x94, 0x69, 0x63, 0x8C, 0xA1, 0x80, 0x5F, 0x74,
+    0x9C, 0x97, 0x6C, 0x62, 0x88, 0xA1, 0x84, 0x61, 0x70, 0x99, 0x99, 0x70, 0x61, 0x84, 0xA0, 0x88,
+    0x63, 0x6D, 0x96, 0x9B, 0x74, 0x61, 0x80, 0x9F, 0x8C, 0x65, 0x6A, 0x93, 0x9C, 0x78, 0x61, 0x7C,
+    0x9E, 0x8F, 0x68, 0x68, 0x8F, 0x9D, 0x7C, 0x61, 0x78, 0x9C, 0x92, 0x6B, 0x66, 0x8B, 0x9E, 0x80,
+    0x62, 0x75, 0x99, 0x94, 0x6E, 0x65, 0x87, 0x9E, 0x84, 0x64, 0x72, 0x97, 0x97, 0x72, 0x64, 0x84,
+    0x9D, 0x87, 0x66, 0x6F, 0x94, 0x98, 0x75, 0x64, 0x80, 0x9C, 0x8A, 0x68, 0x6D, 0x91, 0x99, 0x79,
+    0x64, 0x7C, 0x9B, 0x8D, 0x6B, 0x6B, 0x8D, 0x9A, 0x7D, 0x65, 0x79, 0x99, 0x90, 0x6D, 0x69, 0x8A,
+    0x9B, 0x80, 0x66, 0x76, 0x97, 0x92, 0x70, 0x68, 0x87, 0x9A, 0x83, 0x67, 0x73, 0x94, 0x94, 0x73,
+    0x67, 0x83, 0x9A, 0x86, 0x69, 0x71, 0x92, 0x96, 0x77, 0x67, 0x80, 0x99, 0x89, 0x6B, 0x6F, 0x8F,
+    0x97, 0x7A, 0x67, 0x7D, 0x98, 0x8C, 0x6D, 0x6D, 0x8C, 0x97, 0x7D, 0x68, 0x7A, 0x96, 0x8E, 0x6F,
+    0x6C, 0x89, 0x98, 0x80, 0x68, 0x77, 0x94, 0x90, 0x72, 0x6A, 0x86, 0x98, 0x83, 0x6A, 0x75, 0x92,
+    0x92, 0x75, 0x6A, 0x83, 0x97, 0x86, 0x6B, 0x72, 0x90, 0x93, 0x78, 0x6A, 0x80, 0x96, 0x88, 0x6D,
+    0x71, 0x8D, 0x94, 0x7A, 0x6A, 0x7D, 0x95, 0x8B, 0x6F, 0x6F, 0x8B, 0x95, 0x7D, 0x6A, 0x7B, 0x94,
+    0x8D, 0x71, 0x6E, 0x88, 0x95, 0x80, 0x6B, 0x78, 0x92, 0x8F, 0x73, 0x6D, 0x85, 0x95, 0x83, 0x6C,
+    0x76, 0x90, 0x90, 0x76, 0x6C, 0x83, 0x95, 0x85, 0x6D, 0x74, 0x8E, 0x91, 0x78, 0x6C, 0x80, 0x94,
+    0x87, 0x6F, 0x72, 0x8C, 0x92, 0x7B, 0x6C, 0x7E, 0x93, 0x8A, 0x71, 0x71, 0x89, 0x93, 0x7E, 0x6C,
+    0x7B, 0x92, 0x8B, 0x73, 0x70, 0x87, 0x93, 0x80, 0x6D, 0x79, 0x90, 0x8D, 0x75, 0x6F, 0x85, 0x93,
+    0x82, 0x6E, 0x77, 0x8E, 0x8E, 0x77, 0x6E, 0x82, 0x92, 0x85, 0x6F, 0x75, 0x8D, 0x8F, 0x79, 0x6E,
+    0x80, 0x92, 0x87, 0x71, 0x74, 0x8B, 0x90, 0x7C, 0x6E, 0x7E, 0x91, 0x89, 0x72, 0x72, 0x88, 0x91,
+    0x7E, 0x6F, 0x7C, 0x90, 0x8A, 0x74, 0x71, 0x86, 0x91, 0x80, 0x6F, 0x7A, 0x8E, 0x8C, 0x76, 0x71,
+    0x84, 0x91, 0x82, 0x70, 0x78, 0x8D, 0x8D, 0x78, 0x70, 0x82, 0x91, 0x84, 0x71, 0x76, 0x8B, 0x8E,
+    0x7A, 0x70, 0x80, 0x90, 0x86, 0x72, 0x75, 0x89, 0x8F, 0x7C, 0x70, 0x7E, 0x8F, 0x88, 0x74, 0x74,
+    0x88, 0x8F, 0x7E, 0x70, 0x7C, 0x8E, 0x89, 0x75, 0x73, 0x86, 0x8F, 0x80, 0x71, 0x7A, 0x8D, 0x8A,
+    0x77, 0x72, 0x84, 0x8F, 0x82, 0x72, 0x79, 0x8C, 0x8B, 0x79, 0x72, 0x82, 0x8F, 0x84, 0x73, 0x77,
+    0x8A, 0x8C, 0x7B, 0x72, 0x80, 0x8E, 0x85, 0x74, 0x76, 0x88, 0x8D, 0x7C, 0x72, 0x7E, 0x8E, 0x87,
+    0x75, 0x75, 0x87, 0x8D, 0x7E, 0x72, 0x7D, 0x8D, 0x88, 0x77, 0x74, 0x85, 0x8E, 0x80, 0x73, 0x7B,
+    0x8C, 0x89, 0x78, 0x74, 0x83, 0x8D, 0x82, 0x73, 0x7A, 0x8A, 0x8A, 0x7A, 0x73, 0x82, 0x8D, 0x83,
+    0x74, 0x78, 0x89, 0x8B, 0x7B, 0x73, 0x80, 0x8D, 0x85, 0x75, 0x77, 0x88, 0x8C, 0x7D, 0x73, 0x7E
+};
@@ -0,0 +1,19 @@
+/*
+ * File:   sounds.h
+ * @brief Header file for the built-in PCM clips.
+ *
+ * This file contains the declarations of the clips stored in program memory and played by AUDIO_PcmPlay.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef SOUNDS_H
+#define	SOUNDS_H
+
+/* 8 bit unsigned samples, 0x80 is the silence level */
+#define SOUND_CHIME_RATE 8000
+#define SOUND_CHIME_LENGTH 1600 // 200 ms: E6 then A6, decaying
+
+extern const unsigned char soundChime[SOUND_CHIME_LENGTH];
+
+#endif	/* SOUNDS_H */
@@ -1,10 +1,18 @@
+#include <string.h>
 #include "spiflash.h"
+#include "clock.h"
 #include "config.h"
 #include "timer.h"
 #include "uart.h"
 #include <p32xxxx.h>
 
 unsigned char rd[10], wr[10];
+unsigned int spiFrequency = 0; // SPI clock requested to SPIFLASH_ConfigureSPI (Hz)
+
+unsigned char cachePage[SPIFLASH_CACHE_PAGES][SPIFLASH_PAGE_SIZE];
+unsigned int cacheAddr[SPIFLASH_CACHE_PAGES]; // page address, SPIFLASH_CACHE_EMPTY if unused
+unsigned int cacheUse[SPIFLASH_CACHE_PAGES]; // cacheClock at the last access (LRU)
+unsigned int cacheClock = 0;
 
 /***	SPIFLASH_Init
 **
@@ -19,20 +27,21 @@ unsigned char rd[10], wr[10];
 **      The following digital pins are configured as digital outputs (SPIFLASH_CE, SPIFLASH_SCK, SPIFLASH_SI).
 **      The following digital pins are configured as digital inputs (SPIFLASH_SO).
 **      The SPIFLASH_SI and SPIFLASH_SO are mapped over the SPI1 interface.
-**      The SPI1 module of PIC32 is configured to work at 1 Mhz, polarity 0 and edge 1.
+**      The SPI1 module of PIC32 is configured to work at up to SPIFLASH_MAX_SCK, polarity 0 and edge 1.
 **      
 **          
 */
 void SPIFLASH_Init()
 {
     SPIFLASH_ConfigurePins();
-    SPIFLASH_ConfigureSPI(1250000, 0, 1); // 1.25MHz -> 15
+    SPIFLASH_ConfigureSPI(SPIFLASH_MAX_SCK, 0, 1); // 20MHz at PB 40MHz -> 0
+    SPIFLASH_CacheInvalidate();
 }
 
 /***	SPIFLASH_ConfigureSPI
 **
 **	Parameters:
-**		unsigned int spiFreq - SPI clock frequency (Hz).
+**		unsigned int spiFreq - Maximum SPI clock frequency (Hz).
 **                             for example 1000000 corresponds to 1 MHz
 **		unsigned char pol - SPI Clock Polarity, similar to CKP field of SPIxCON
 **                  1 = Idle state for clock is a high level; active state is a low level
@@ -46,14 +55,15 @@ void SPIFLASH_Init()
 **
 **	Description:
 **		This function configures the SPI1 hardware interface of PIC32, according to the provided parameters.
-**      In order to compute the baud rate value, it uses the peripheral bus frequency definition (PB_FRQ, located in config.h)
+**      In order to compute the baud rate value, it uses the current peripheral bus frequency (CLOCK_GetPB).
 **      
 **          
 */
 void SPIFLASH_ConfigureSPI(unsigned int spiFreq, unsigned char pol, unsigned char edge)
 {
     // configures SPI1
-    SPI1BRG = PB_CLK / (2 * spiFreq) - 1;
+    spiFrequency = spiFreq;
+    SPI1BRG = SPIFLASH_GetBRG();
     SPI1CONbits.CKP = pol;    // SPI Clock Polarity
     SPI1CONbits.CKE = edge;   // SPI Clock Edge  
     SPI1CONbits.SMP = 0;      // SPI Data Input Sample Phase 
@@ -64,6 +74,49 @@ void SPIFLASH_ConfigureSPI(unsigned int spiFreq, unsigned char pol, unsigned cha
     SPI1CONbits.ON = 1;       // enable SPI
 }
 
+/***	SPIFLASH_ClockChanged
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function recomputes the SPI1 baud rate for the new peripheral bus clock, so each profile
+**      reads the flash as fast as its divider allows: 5 MHz at 10 MHz, SPIFLASH_MAX_SCK from 40 MHz.
+**      The module is turned off while SPI1BRG is written.
+**      
+**          
+*/
+void SPIFLASH_ClockChanged()
+{
+    SPI1CONbits.ON = 0;
+    SPI1BRG = SPIFLASH_GetBRG();
+    SPI1CONbits.ON = 1;
+}
+
+/***	SPIFLASH_GetBRG
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		unsigned int - SPI1BRG value.
+**
+**	Description:
+**		This function returns the divisor of the fastest SCK (PB / (2 * (BRG + 1))) that is not above
+**      the frequency requested to SPIFLASH_ConfigureSPI.
+**      
+**          
+*/
+unsigned int SPIFLASH_GetBRG()
+{
+    unsigned int divider = 2 * spiFrequency;
+    
+    return (CLOCK_GetPB() + divider - 1) / divider - 1; // Rounded up: SCK never above spiFrequency
+}
+
 /***	SPIFLASH_ConfigurePins
 **
 **	Parameters:
@@ -232,6 +285,23 @@ void SPIFLASH_WaitUntilNoBusy()
     while(SPIFLASH_GetStatus() & SPIFLASH_STATUS_BUSY);
 }
 
+/***	SPIFLASH_IsBusy
+**
+**	Parameters:
+**
+**	Return Value:
+**      int                     - 1 while a program or erase operation is in progress
+**
+**	Description:
+**		This function reads the Status Register and returns the Busy flag. 
+**      
+**          
+*/
+int SPIFLASH_IsBusy()
+{
+    return SPIFLASH_GetStatus() & SPIFLASH_STATUS_BUSY;
+}
+
 /***	SPIFLASH_WriteEnable
 **
 **	Parameters:
@@ -287,6 +357,57 @@ void SPIFLASH_EraseAll()
     SPIFLASH_WriteEnable();
     SPIFLASH_SendOneByteCmd(SPIFLASH_CMD_ERASE_ALL);
     SPIFLASH_WaitUntilNoBusy();
+    SPIFLASH_CacheInvalidate();
+}
+
+/***	SPIFLASH_EraseSector
+**
+**	Parameters:
+**      unsigned int addr       - Any address inside the 4KB sector to be erased
+**
+**	Return Value:
+**      
+**
+**	Description:
+**		This functions performs a sector erase: sets all the bytes of the 4KB sector containing addr to 0xFF.
+**      
+**          
+*/
+void SPIFLASH_EraseSector(unsigned int addr)
+{
+    SPIFLASH_StartEraseSector(addr);
+    SPIFLASH_WaitUntilNoBusy();
+}
+
+/***	SPIFLASH_StartEraseSector
+**
+**	Parameters:
+**      unsigned int addr       - Any address inside the 4KB sector to be erased
+**
+**	Return Value:
+**      
+**
+**	Description:
+**		This functions starts a sector erase and returns without waiting for its end
+**      (use SPIFLASH_IsBusy to know when the device is ready again).
+**      
+**          
+*/
+void SPIFLASH_StartEraseSector(unsigned int addr)
+{
+    SPIFLASH_WaitUntilNoBusy();
+    SPIFLASH_WriteEnable();
+    
+    lat_SPIFLASH_CS = 0; // Activate SS
+    
+    SPIFLASH_RawTransferByte(SPIFLASH_CMD_ERASE_SECTOR);
+    SPIFLASH_RawTransferByte(addr >> 16);
+    SPIFLASH_RawTransferByte(addr >> 8);
+    SPIFLASH_RawTransferByte(addr & 0xFF);
+    
+    lat_SPIFLASH_CS = 1; // Deactivate SS
+    
+    SPIFLASH_CacheErase(addr & ~(SPIFLASH_SECTOR_SIZE - 1), SPIFLASH_SECTOR_SIZE);
 }
 
 /***	SPIFLASH_ProgramPage
@@ -308,7 +429,29 @@ void SPIFLASH_EraseAll()
 */
 void SPIFLASH_ProgramPage(unsigned int addr, unsigned char *pBuf, unsigned int len)
 {
-    int i;
+    SPIFLASH_StartProgramPage(addr, pBuf, len);
+    SPIFLASH_WaitUntilNoBusy();
+}
+
+/***	SPIFLASH_StartProgramPage
+**
+**	Parameters:
+**      unsigned int addr       - The memory address where data will be written
+**      unsigned char *pBuf     - Pointer to a buffer storing the bytes to be written. 
+**      int len                 - Number of bytes to be written.
+ **
+**	Return Value:
+**      
+**
+**	Description:
+**		This functions sends the Page Program command and the data, and returns without
+**      waiting for the internal programming time (use SPIFLASH_IsBusy).
+**      
+**          
+*/
+void SPIFLASH_StartProgramPage(unsigned int addr, unsigned char *pBuf, unsigned int len)
+{
+    unsigned int i;
     SPIFLASH_WaitUntilNoBusy();
     SPIFLASH_WriteEnable();
     
@@ -323,32 +466,100 @@ void SPIFLASH_ProgramPage(unsigned int addr, unsigned char *pBuf, unsigned int l
         SPIFLASH_RawTransferByte(pBuf[i]);
     }
     lat_SPIFLASH_CS = 1; // Deactivate SS
-    SPIFLASH_WaitUntilNoBusy();
+    
+    SPIFLASH_CacheProgram(addr, pBuf, len);
 }
 
-/***	SPIFLASH_ProgramPage
+/***	SPIFLASH_ProgramVerify
 **
 **	Parameters:
 **      unsigned int addr       - The memory address where data will be written
 **      unsigned char *pBuf     - Pointer to a buffer storing the bytes to be written. 
+**      int len                 - Number of bytes to be written (within one page).
+ **
+**	Return Value:
+**      int                     - SPIFLASH_OK, SPIFLASH_ERR_VERIFY or SPIFLASH_ERR_NOT_ERASED
 **
+**	Description:
+**		This functions programs a page and checks it: the end of the programming is detected
+**      by polling the Busy flag and the data is compared by CRC while it is read back, so no
+**      fixed delay and no read buffer are needed. A failed check is retried (programming the
+**      same data again only clears the bits left at 1), unless the location was not erased:
+**      in that case the caller has to erase it or use another location.
+**      
+**          
+*/
+int SPIFLASH_ProgramVerify(unsigned int addr, unsigned char *pBuf, unsigned int len)
+{
+    for(int i = 0; i <= SPIFLASH_PROGRAM_RETRIES; i++)
+    {
+        SPIFLASH_ProgramPage(addr, pBuf, len);
+        if(SPIFLASH_Verify(addr, pBuf, len) == SPIFLASH_OK)
+            return SPIFLASH_OK;
+        SPIFLASH_CacheInvalidate(); // The cached copy holds the data expected, not the data read
+        if(!SPIFLASH_IsProgrammable(addr, pBuf, len))
+            return SPIFLASH_ERR_NOT_ERASED;
+    }
+    return SPIFLASH_ERR_VERIFY;
+}
+
+/***	SPIFLASH_Verify
+**
+**	Parameters:
+**      unsigned int addr       - The memory address of the data
+**      unsigned char *pBuf     - Pointer to a buffer storing the expected bytes. 
+**      int len                 - Number of bytes to be checked.
+ **
 **	Return Value:
+**      int                     - SPIFLASH_OK or SPIFLASH_ERR_VERIFY
+**
+**	Description:
+**		This functions compares the CRC of the memory with the CRC of the buffer.
 **      
+**          
+*/
+int SPIFLASH_Verify(unsigned int addr, unsigned char *pBuf, unsigned int len)
+{
+    if(SPIFLASH_ReadCRC16(addr, len) != SPIFLASH_CRC16(0xFFFF, pBuf, len))
+        return SPIFLASH_ERR_VERIFY;
+    return SPIFLASH_OK;
+}
+
+/***	SPIFLASH_IsProgrammable
+**
+**	Parameters:
+**      unsigned int addr       - The memory address of the data
+**      unsigned char *pBuf     - Pointer to a buffer storing the bytes to be written. 
+**      int len                 - Number of bytes to be checked.
+ **
+**	Return Value:
+**      int                     - 1 if programming can turn the memory into the buffer
 **
 **	Description:
-**		This functions calls the Page Program command: 
-**      it allows 2 bytes of data to be programmed 
-**      at previously erased memory locations.
+**		This functions checks that no bit to be written as 1 is already 0 
+**      (programming can only change bits from 1 to 0).
 **      
 **          
 */
-void SPIFALSH_Write2Byte(unsigned int addr, unsigned short buff) {
-    unsigned char pBuff[2];
+int SPIFLASH_IsProgrammable(unsigned int addr, unsigned char *pBuf, unsigned int len)
+{
+    unsigned int i;
+    int ok = 1;
     
-    pBuff[0] = buff;
-    pBuff[1] = (buff >> 8);
+    SPIFLASH_WaitUntilNoBusy();
+    lat_SPIFLASH_CS = 0; // Activate SS
     
-    SPIFLASH_ProgramPage(addr, pBuff, 2);
+    SPIFLASH_RawTransferByte(SPIFLASH_CMD_READ);
+    SPIFLASH_RawTransferByte(addr >> 16);
+    SPIFLASH_RawTransferByte(addr >> 8);
+    SPIFLASH_RawTransferByte(addr & 0xFF);
+    for(i = 0; i< len; i++)
+    {
+        if(pBuf[i] & ~SPIFLASH_RawTransferByte(0))
+            ok = 0;
+    }
+    lat_SPIFLASH_CS = 1; // Deactivate SS
+    return ok;
 }
 
 /***	SPIFLASH_Read
@@ -362,15 +573,60 @@ void SPIFALSH_Write2Byte(unsigned int addr, unsigned short buff) {
 **      
 **
 **	Description:
+**		This functions reads one or more data bytes. The parts smaller than a page are served
+**      by the RAM cache (the page is loaded on a miss, replacing the least recently used one),
+**      so repeated metadata reads do not access the memory. Whole pages are read directly
+**      and do not evict the cached ones.
+**      
+**          
+*/
+void SPIFLASH_Read(unsigned int addr, unsigned char *pBuf, unsigned int len)
+{
+    while(len > 0)
+    {
+        unsigned int page = addr & ~(SPIFLASH_PAGE_SIZE - 1);
+        unsigned int offset = addr - page;
+        unsigned int n = SPIFLASH_PAGE_SIZE - offset;
+        if(n > len)
+            n = len;
+        
+        int slot = SPIFLASH_CacheLookup(page);
+        if(slot < 0 && n < SPIFLASH_PAGE_SIZE)
+            slot = SPIFLASH_CacheFill(page);
+        
+        if(slot >= 0)
+            memcpy(pBuf, cachePage[slot] + offset, n);
+        else
+            SPIFLASH_ReadDirect(addr, pBuf, n);
+        
+        addr += n;
+        pBuf += n;
+        len -= n;
+    }
+}
+
+/***	SPIFLASH_ReadDirect
+**
+**	Parameters:
+**      unsigned int addr       - The memory address fromm where the data will be read
+**      unsigned char *pBuf     - Pointer to a buffer storing the read bytes. 
+**      int len                 - Number of bytes to be read.
+ **
+**	Return Value:
+**      
+**
+**	Description:
 **		This functions calls the Read Data command:
 **      it allows one or more data bytes to be sequentially read from the memory. 
+**      A program or erase in progress is waited for first.
 **      
 **          
 */
-void SPIFLASH_Read(unsigned int addr, unsigned char *pBuf, unsigned int len)
+void SPIFLASH_ReadDirect(unsigned int addr, unsigned char *pBuf, unsigned int len)
 {
-    int i;
+    unsigned int i;
     
+    SPIFLASH_WaitUntilNoBusy();
     lat_SPIFLASH_CS = 0; // Activate SS
     
     SPIFLASH_RawTransferByte(SPIFLASH_CMD_READ);
@@ -384,24 +640,204 @@ void SPIFLASH_Read(unsigned int addr, unsigned char *pBuf, unsigned int len)
     lat_SPIFLASH_CS = 1; // Deactivate SS
 }
 
-/***	SPIFLASH_Read2Byte
+/***	SPIFLASH_CRC16
+**
+**	Parameters:
+**      unsigned short crc      - The initial value (0xFFFF) or the result of a previous call
+**      unsigned char *pBuf     - Pointer to the bytes to be checked.
+**      int len                 - Number of bytes.
+**
+**	Return Value:
+**      unsigned short          - The updated CRC
+**
+**	Description:
+**		This functions computes the CRC-16/CCITT (poly 0x1021) of a buffer, 
+**      using a 16 entries nibble table to keep both flash and time cost low.
+**      
+**          
+*/
+unsigned short SPIFLASH_CRC16(unsigned short crc, unsigned char *pBuf, unsigned int len)
+{
+    static const unsigned short table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    unsigned int i;
+    
+    for(i = 0; i < len; i++)
+    {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (pBuf[i] >> 4)];
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (pBuf[i] & 0x0F)];
+    }
+    return crc;
+}
+
+/***	SPIFLASH_ReadCRC16
 **
 **	Parameters:
 **      unsigned int addr       - The memory address fromm where the data will be read
+**      int len                 - Number of bytes to be read.
+**
+**	Return Value:
+**      unsigned short          - The CRC of the memory
+**
+**	Description:
+**		This functions reads the memory and computes its CRC-16/CCITT (initial value 0xFFFF)
+**      byte by byte, without a buffer.
+**      
+**          
+*/
+unsigned short SPIFLASH_ReadCRC16(unsigned int addr, unsigned int len)
+{
+    unsigned short crc = 0xFFFF;
+    unsigned char bVal;
+    unsigned int i;
+    
+    SPIFLASH_WaitUntilNoBusy();
+    lat_SPIFLASH_CS = 0; // Activate SS
+    
+    SPIFLASH_RawTransferByte(SPIFLASH_CMD_READ);
+    SPIFLASH_RawTransferByte(addr >> 16);
+    SPIFLASH_RawTransferByte(addr >> 8);
+    SPIFLASH_RawTransferByte(addr & 0xFF);
+    for(i = 0; i< len; i++)
+    {
+        bVal = SPIFLASH_RawTransferByte(0);
+        crc = SPIFLASH_CRC16(crc, &bVal, 1);
+    }
+    lat_SPIFLASH_CS = 1; // Deactivate SS
+    return crc;
+}
+
+/***	SPIFLASH_CacheInvalidate
+**
+**	Parameters:
 **
 **	Return Value:
 **      
 **
 **	Description:
-**		This functions calls the Read Data command:
-**      it allows 2 data bytes to be sequentially read from the memory. 
+**		This functions empties the read cache.
+**      
+**          
+*/
+void SPIFLASH_CacheInvalidate()
+{
+    for(int i = 0; i < SPIFLASH_CACHE_PAGES; i++)
+        cacheAddr[i] = SPIFLASH_CACHE_EMPTY;
+}
+
+/***	SPIFLASH_CacheLookup
+**
+**	Parameters:
+**      unsigned int page       - Page address
+**
+**	Return Value:
+**      int                     - Cache slot holding the page, -1 on a miss
+**
+**	Description:
+**		This functions looks for a page in the cache and marks it as used.
+**      
+**          
+*/
+int SPIFLASH_CacheLookup(unsigned int page)
+{
+    for(int i = 0; i < SPIFLASH_CACHE_PAGES; i++)
+    {
+        if(cacheAddr[i] == page)
+        {
+            cacheUse[i] = ++cacheClock;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/***	SPIFLASH_CacheFill
+**
+**	Parameters:
+**      unsigned int page       - Page address
+**
+**	Return Value:
+**      int                     - Cache slot loaded with the page
+**
+**	Description:
+**		This functions reads a page into the least recently used slot.
+**      
+**          
+*/
+int SPIFLASH_CacheFill(unsigned int page)
+{
+    int slot = 0;
+    
+    for(int i = 0; i < SPIFLASH_CACHE_PAGES; i++)
+    {
+        if(cacheAddr[i] == SPIFLASH_CACHE_EMPTY)
+        {
+            slot = i;
+            break;
+        }
+        if(cacheUse[i] < cacheUse[slot])
+            slot = i;
+    }
+    
+    SPIFLASH_ReadDirect(page, cachePage[slot], SPIFLASH_PAGE_SIZE);
+    cacheAddr[slot] = page;
+    cacheUse[slot] = ++cacheClock;
+    return slot;
+}
+
+/***	SPIFLASH_CacheProgram
+**
+**	Parameters:
+**      unsigned int addr       - The memory address where data is written
+**      unsigned char *pBuf     - Pointer to the bytes written. 
+**      int len                 - Number of bytes written.
+**
+**	Return Value:
+**      
+**
+**	Description:
+**		This functions applies a page program to the cached copy (write-through): the bits
+**      can only be cleared and the address wraps inside the page, as in the memory.
 **      
 **          
 */
-unsigned short SPIFLASH_Read2Byte(unsigned int addr) {
-    unsigned char buff[2];
-    SPIFLASH_Read(addr, buff, 2);
-    return (buff[1] << 8) | buff[0];
+void SPIFLASH_CacheProgram(unsigned int addr, unsigned char *pBuf, unsigned int len)
+{
+    unsigned int page = addr & ~(SPIFLASH_PAGE_SIZE - 1);
+    
+    for(int i = 0; i < SPIFLASH_CACHE_PAGES; i++)
+    {
+        if(cacheAddr[i] == page)
+        {
+            for(unsigned int j = 0; j < len; j++)
+                cachePage[i][(addr + j) & (SPIFLASH_PAGE_SIZE - 1)] &= pBuf[j];
+        }
+    }
+}
+
+/***	SPIFLASH_CacheErase
+**
+**	Parameters:
+**      unsigned int addr       - First erased address
+**      int len                 - Number of bytes erased.
+**
+**	Return Value:
+**      
+**
+**	Description:
+**		This functions applies an erase to the cached pages inside the erased area.
+**      
+**          
+*/
+void SPIFLASH_CacheErase(unsigned int addr, unsigned int len)
+{
+    for(int i = 0; i < SPIFLASH_CACHE_PAGES; i++)
+    {
+        if(cacheAddr[i] != SPIFLASH_CACHE_EMPTY && cacheAddr[i] - addr < len)
+            memset(cachePage[i], 0xFF, SPIFLASH_PAGE_SIZE);
+    }
 }
 
 /***	SPIFLASH_Close
@@ -28,6 +28,7 @@
 #define SPIFLASH_CMD_READ               0x03    // SPI Flash opcode: Read up up to 25MHz
 #define SPIFLASH_CMD_READ_FAST			0x0B    // SPI Flash opcode: Read up to 50MHz with 1 dummy byte
 #define SPIFLASH_CMD_ERASE_ALL			0x60    // SPI Flash opcode: Entire chip erase
+#define SPIFLASH_CMD_ERASE_SECTOR       0x20    // SPI Flash opcode: 4KB sector erase
 #define SPIFLASH_CMD_WRITE				0x02    // SPI Flash opcode: Write one byte (or a page of up to 256 bytes, depending on device)
 #define SPIFLASH_CMD_WRITE_WORD_STREAM	0xAD    // SPI Flash opcode: Write continuous stream of 16-bit words (AAI mode); available on SST25VF016B (but not on SST25VF010A)
 #define SPIFLASH_CMD_WRITE_BYTE_STREAM	0xAF    // SPI Flash opcode: Write continuous stream of bytes (AAI mode); available on SST25VF010A (but not on SST25VF016B)
@@ -44,24 +45,52 @@
 
 #define SPIFLASH_STATUS_BUSY            0x01    // Busy bit of SR1
 
+#define SPIFLASH_PAGE_SIZE              0x100   // Page program unit
+#define SPIFLASH_MAX_SCK                20000000 // Hz, SPIFLASH_CMD_READ and the SPI1 module are rated 25 MHz
+
+/* read cache: reads smaller than a page are served from RAM, whole pages bypass it */
+#define SPIFLASH_CACHE_PAGES            4
+#define SPIFLASH_CACHE_EMPTY            0xFFFFFFFF
+
+/* SPIFLASH_ProgramVerify status */
+#define SPIFLASH_OK                     0
+#define SPIFLASH_ERR_VERIFY             -1      // Data still wrong after the retries
+#define SPIFLASH_ERR_NOT_ERASED         -2      // A bit to be written as 1 is 0: erase or use another location
+#define SPIFLASH_PROGRAM_RETRIES        2
+
 /* public functions */
 void SPIFLASH_Init();
 void SPIFLASH_EraseAll();
+void SPIFLASH_EraseSector(unsigned int addr);
+void SPIFLASH_StartEraseSector(unsigned int addr);
 unsigned char SPIFLASH_ReleasePowerDownGetDeviceID();
 void SPIFLASH_ProgramPage(unsigned int addr, unsigned char *pBuf, unsigned int len);
+void SPIFLASH_StartProgramPage(unsigned int addr, unsigned char *pBuf, unsigned int len);
+int SPIFLASH_ProgramVerify(unsigned int addr, unsigned char *pBuf, unsigned int len);
+int SPIFLASH_Verify(unsigned int addr, unsigned char *pBuf, unsigned int len);
+int SPIFLASH_IsBusy();
 void SPIFLASH_Read(unsigned int addr, unsigned char *pBuf, unsigned int len);
 void SPIFLASH_Close();
-void SPIFALSH_Write2Byte(unsigned int addr, unsigned short buff);
-unsigned short SPIFLASH_Read2Byte(unsigned int addr);
+unsigned short SPIFLASH_CRC16(unsigned short crc, unsigned char *pBuf, unsigned int len);
+unsigned short SPIFLASH_ReadCRC16(unsigned int addr, unsigned int len);
+void SPIFLASH_CacheInvalidate();
+void SPIFLASH_ClockChanged();
 
 /* private functions */
 void SPIFLASH_ConfigurePins();
 void SPIFLASH_ConfigureSPI(unsigned int spiFreq, unsigned char pol, unsigned char edge);
+unsigned int SPIFLASH_GetBRG();
 void SPIFLASH_SendOneByteCmd(unsigned char bCmd);
 unsigned char SPIFLASH_GetStatus();
 void SPIFLASH_WaitUntilNoBusy();
 void SPIFLASH_WriteEnable();
 void SPIFLASH_WriteDisable();
+int SPIFLASH_IsProgrammable(unsigned int addr, unsigned char *pBuf, unsigned int len);
+void SPIFLASH_ReadDirect(unsigned int addr, unsigned char *pBuf, unsigned int len);
+int SPIFLASH_CacheLookup(unsigned int page);
+int SPIFLASH_CacheFill(unsigned int page);
+void SPIFLASH_CacheProgram(unsigned int addr, unsigned char *pBuf, unsigned int len);
+void SPIFLASH_CacheErase(unsigned int addr, unsigned int len);
 void SPIFLASH_ConfigurePins();
 unsigned char SPIFLASH_TransferByte(unsigned char bVal);
 void SPIFLASH_TransferBytes(unsigned char bytesNumber, unsigned char *pbRdData, unsigned char *pbWrData);
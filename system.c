@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include "system.h"
+#include "audio.h"
+#include "spiflash.h"
+#include "timer.h"
+#include "uart.h"
+#include <p32xxxx.h>
+
+unsigned char systemBenchData[SYSTEM_BENCH_SIZE];
+
+/***	SYSTEM_Init
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function sets the performance configuration, to be called first at startup: the
+**      minimum flash wait states for SYS_CLK, predictive prefetch, kseg0 cached (the code runs
+**      from the prefetch cache lines) and no data RAM wait state.
+**      
+**          
+*/
+void SYSTEM_Init() {
+    SYSTEM_SetCache(SYSTEM_FLASH_WS, SYSTEM_PREFETCH_ALL, SYSTEM_K0_CACHED);
+    BMXCONbits.BMXWSDRM = 0; // Data RAM access without wait state
+}
+
+/***	SYSTEM_SetCache
+**
+**	Parameters:
+**      unsigned int ws - Flash wait states (CHECON.PFMWS).
+**      unsigned int prefetch - SYSTEM_PREFETCH_x (CHECON.PREFEN).
+**      unsigned int k0 - SYSTEM_K0_x (CP0 Config.K0).
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function programs the prefetch cache module and the kseg0 cache policy.
+**      The wait states must never be lower than SYSTEM_FLASH_WS.
+**      
+**          
+*/
+void SYSTEM_SetCache(unsigned int ws, unsigned int prefetch, unsigned int k0) {
+    unsigned int config;
+    
+    CHECONbits.PFMWS = ws < SYSTEM_FLASH_WS ? SYSTEM_FLASH_WS : ws;
+    CHECONbits.PREFEN = prefetch;
+    
+    asm volatile("mfc0 %0,$16" : "=r"(config)); // CP0 Config
+    config = (config & ~0x7) | k0;
+    asm volatile("mtc0 %0,$16" : : "r"(config));
+    asm volatile("ehb");
+}
+
+/***	SYSTEM_Benchmark
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function runs the same workload with the reset configuration (7 wait states, no prefetch,
+**      kseg0 uncached), with the wait states only and with the full configuration, prints the core
+**      timer ticks and the speed-up, and leaves the full configuration set.
+**      
+**          
+*/
+void SYSTEM_Benchmark() {
+    static const char *names[3] = {"Reset", "Wait state", "Prefetch + cache"};
+    static const unsigned char ws[3] = {SYSTEM_FLASH_WS_MAX, SYSTEM_FLASH_WS, SYSTEM_FLASH_WS};
+    static const unsigned char prefetch[3] = {SYSTEM_PREFETCH_OFF, SYSTEM_PREFETCH_OFF, SYSTEM_PREFETCH_ALL};
+    static const unsigned char k0[3] = {SYSTEM_K0_UNCACHED, SYSTEM_K0_UNCACHED, SYSTEM_K0_CACHED};
+    unsigned int ticks[3];
+    char uartPrint[70];
+    
+    for (int i = 0; i < SYSTEM_BENCH_SIZE; i++)
+        systemBenchData[i] = i * 7;
+    
+    for (int i = 0; i < 3; i++) {
+        SYSTEM_SetCache(ws[i], prefetch[i], k0[i]);
+        ticks[i] = SYSTEM_BenchRun();
+    }
+    
+    for (int i = 0; i < 3; i++) {
+        unsigned int speedup = ticks[0] * 10 / ticks[i]; // x10
+        snprintf(uartPrint, sizeof(uartPrint), "%s: %u us, x%u.%u\n", names[i], ticks[i] / CORE_TICKS_PER_US,
+                speedup / 10, speedup % 10);
+        UART_PutString(uartPrint);
+    }
+}
+
+/***	SYSTEM_BenchRun
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**      unsigned int - Core timer ticks of the fastest run.
+**
+**	Description:
+**		This function times a workload made of the main loop hot paths: the table CRC16 used by
+**      the flash and log code (memory bound) and the hue mapping of the sonification (branches).
+**      
+**          
+*/
+unsigned int SYSTEM_BenchRun() {
+    unsigned int best = 0xFFFFFFFF;
+    volatile int sink = 0;
+    
+    for (int run = 0; run < SYSTEM_BENCH_RUNS; run++) {
+        unsigned int start = TIMER_GetCoreTicks();
+        
+        sink += SPIFLASH_CRC16(0xFFFF, systemBenchData, SYSTEM_BENCH_SIZE);
+        for (unsigned int r = 0; r < 256; r += 5) {
+            for (unsigned int g = 0; g < 256; g += 15)
+                sink += AUDIO_HueStep(r, g, 255 - r);
+        }
+        
+        unsigned int ticks = TIMER_GetCoreTicks() - start;
+        if (ticks < best)
+            best = ticks;
+    }
+    return best;
+}
@@ -0,0 +1,40 @@
+/*
+ * File:   system.h
+ * @brief Header file for the system performance configuration.
+ *
+ * This file contains the definitions and function prototypes for configuring the flash wait states,
+ * the prefetch cache and the kseg0 cacheability, and for measuring their effect.
+ *
+ * @date October 19, 2026
+ */
+
+#ifndef SYSTEM_H
+#define	SYSTEM_H
+
+#include "config.h"
+
+/* flash: one wait state every SYSTEM_FLASH_HZ of SYS_CLK (same rule as the plib SYSTEMConfigPerformance) */
+#define SYSTEM_FLASH_HZ 30000000
+#define SYSTEM_FLASH_WS ((SYS_CLK - 1) / SYSTEM_FLASH_HZ) // 2 at 80 MHz
+#define SYSTEM_FLASH_WS_MAX 7 // reset value
+
+/* CHECON.PREFEN */
+#define SYSTEM_PREFETCH_OFF 0
+#define SYSTEM_PREFETCH_ALL 3 // cacheable and non-cacheable regions
+
+/* CP0 Config.K0 */
+#define SYSTEM_K0_UNCACHED 2
+#define SYSTEM_K0_CACHED 3
+
+#define SYSTEM_BENCH_RUNS 3 // best of, to drop the runs hit by interrupts
+#define SYSTEM_BENCH_SIZE 2048 // bytes of the CRC workload
+
+/* public functions */
+void SYSTEM_Init();
+void SYSTEM_Benchmark();
+
+/* private functions */
+void SYSTEM_SetCache(unsigned int ws, unsigned int prefetch, unsigned int k0);
+unsigned int SYSTEM_BenchRun();
+
+#endif	/* SYSTEM_H */
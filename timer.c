@@ -1,6 +1,9 @@
 #include <p32xxxx.h>
 #include "timer.h"
 #include "config.h"
+#include "clock.h"
+
+extern volatile unsigned int msTicks;
 
 /***	TIMER2_Init
 **
@@ -29,23 +32,52 @@ void TIMER2_Init() {
 **
 **	Description:
 **		This function configures the settings for Timer 2.
-**      It sets the timer to 16-bit mode, applies a prescaler of 64, and initializes the period register for a 1ms period.
+**      It sets the timer to 16-bit mode and a 1ms period (prescaler and period from TIMER2_ClockChanged).
+**      The period interrupt is the 1ms system tick (msTicks, incremented in main.c).
 **      
 **          
 */
 void TIMER2_ConfigurePins() {
     T2CONbits.ON = 0; // disable timer
     T2CONbits.T32 = MODE_16; // 16 bit mode
-    T2CONbits.TCKPS = PRS_64; // prescaler set to 64
     T2CONbits.TGATE = 0;
     T2CONbits.TCS = 0;
+    TIMER2_ClockChanged(); // 1ms period at the current peripheral clock
     
-    TMR2 = 0; // timer start value
-    PR2 = 625; // Period register 1ms
+    IPC2bits.T2IP = TIMER2_INT_PRIORITY;
+    IPC2bits.T2IS = 0;
+    IFS0bits.T2IF = 0;
+    IEC0bits.T2IE = 1;
             
     T2CONbits.ON = 1; // turn on timer
 }
 
+/***	TIMER2_ClockChanged
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		
+**
+**	Description:
+**		This function recomputes the 1ms period of Timer 2 for the current peripheral bus clock.
+**      It uses the largest prescaler (up to 64) that divides the clock into whole milliseconds:
+**      625 counts at 40 MHz, 1250 at 80 MHz, 625 (prescaler 16) at 10 MHz.
+**      
+**          
+*/
+void TIMER2_ClockChanged() {
+    unsigned int pb = CLOCK_GetPB();
+    int tckps = PRS_64;
+    
+    while (tckps > PRS_1 && (pb >> tckps) % 1000)
+        tckps--;
+    T2CONbits.TCKPS = tckps;
+    TMR2 = 0; // timer start value
+    PR2 = (pb >> tckps) / 1000 - 1; // Period register 1ms
+}
+
 /***	TIMER2_DelayMS
 **
 **	Parameters:
@@ -55,14 +87,55 @@ void TIMER2_ConfigurePins() {
 **		
 **
 **	Description:
-**		This function creates a delay of the specified number of milliseconds using Timer 2.
-**      It resets the timer and waits until it reaches the period value for each millisecond.
+**		This function creates a delay of the specified number of milliseconds.
+**      It counts core timer ticks, so Timer 2 is left free running for the system tick
+**      and the delay also works with interrupts disabled.
 **      
 **          
 */
 void TIMER2_DelayMS(unsigned int ms) {
+    unsigned int start = TIMER_GetCoreTicks();
+    
     for (int i = 0; i < ms; i++) {
-        TMR2 = 0; // Reset Timer1 counter
-        while (TMR2 < PR2 - 1); // Wait until Timer1 reaches the period value
+        start += CORE_TICKS_PER_MS;
+        while ((int) (TIMER_GetCoreTicks() - start) < 0); // Wait the end of this millisecond
     }
 }
+
+/***	TIMER_GetCoreTicks
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		unsigned int - The current value of the core timer.
+**
+**	Description:
+**		This function reads the MIPS core timer (CP0 Count), which runs at SYS_CLK / 2.
+**      It is free running and wraps every ~107 s, so intervals must be computed as differences.
+**      
+**          
+*/
+unsigned int TIMER_GetCoreTicks() {
+    unsigned int val;
+    asm volatile("mfc0 %0,$9" : "=r"(val));
+    return val;
+}
+
+/***	TIMER_GetMS
+**
+**	Parameters:
+**		
+**
+**	Return Value:
+**		unsigned int - Milliseconds since the Timer 2 start (system tick).
+**
+**	Description:
+**		This function returns the system tick counter, incremented by the Timer 2 interrupt.
+**      It wraps after ~49 days.
+**      
+**          
+*/
+unsigned int TIMER_GetMS() {
+    return msTicks;
+}
@@ -27,9 +27,18 @@
 #define MODE_16 0
 #define MODE_32 1
 
+/* core timer (SYS_CLK / 2) */
+#define CORE_TICKS_PER_MS (SYS_CLK / 2000)
+#define CORE_TICKS_PER_US (SYS_CLK / 2000000)
+
+#define TIMER2_INT_PRIORITY 4 // 1ms system tick
+
 /* define public function */
 void TIMER2_Init();
 void TIMER2_DelayMS(unsigned int ms);
+void TIMER2_ClockChanged();
+unsigned int TIMER_GetCoreTicks();
+unsigned int TIMER_GetMS();
 
 /* define private function */
 void TIMER2_ConfigurePins();
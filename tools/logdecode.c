@@ -0,0 +1,194 @@
+/*
+ * File:   logdecode.c
+ * @brief Host decoder for the sample log dump.
+ *
+ * This program reads the binary dump sent by function 9 (LOGGER_Dump) from stdin, checks the frames
+ * and decodes the compressed pages (format in logger.h) to CSV on stdout.
+ *
+ *      gcc -o logdecode tools/logdecode.c
+ *      logdecode [from [to]] < dump.bin > log.csv
+ *
+ * @date October 19, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNC1 0xA5
+#define SYNC2 0x5A
+
+#define PAGE_DATA 255
+#define MAX_SENSORS 8
+
+#define HDR_SENSOR 0x07
+#define HDR_SATURATED 0x08
+#define HDR_SAME_DT 0x10
+#define HDR_NIBBLES 0x20
+#define HDR_RED 0x40
+
+typedef struct {
+    unsigned int time;
+    unsigned int dt;
+    unsigned short prev[MAX_SENSORS][4];
+    int count;
+} Codec;
+
+/***	CRC16
+**
+**	Parameters:
+**      unsigned short crc - Initial value (0xFFFF) or previous result.
+**      unsigned char *buf - Data.
+**      int len - Number of bytes.
+**
+**	Return Value:
+**      unsigned short - CRC16-CCITT, same as SPIFLASH_CRC16.
+**
+**	Description:
+**		This function computes the frame checksum.
+**
+**
+*/
+unsigned short CRC16(unsigned short crc, unsigned char *buf, int len) {
+    for (int i = 0; i < len; i++) {
+        crc ^= buf[i] << 8;
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+/***	GetVarint
+**
+**	Parameters:
+**      unsigned char *buf - Coded data.
+**      int len - Bytes available in buf.
+**      unsigned int *value - Decoded value.
+**
+**	Return Value:
+**      int - Number of bytes used, 0 if the varint is truncated or too long.
+**
+**	Description:
+**		This function mirrors LOGGER_GetVarint.
+**
+**
+*/
+int GetVarint(unsigned char *buf, int len, unsigned int *value) {
+    *value = 0;
+
+    for (int i = 0; i < len && i < 5; i++) {
+        *value |= (unsigned int) (buf[i] & 0x7F) << (7 * i);
+        if (!(buf[i] & 0x80))
+            return i + 1;
+    }
+    return 0;
+}
+
+/***	DecodePage
+**
+**	Parameters:
+**      unsigned char *page - Compressed page.
+**      int len - Page length.
+**      unsigned int from - First time (ms) to be printed.
+**      unsigned int to - Last time (ms) to be printed.
+**
+**	Return Value:
+**      int - Number of records printed.
+**
+**	Description:
+**		This function mirrors LOGGER_DecodeRecord over a whole page and prints the records in [from, to].
+**
+**
+*/
+int DecodePage(unsigned char *page, int len, unsigned int from, unsigned int to) {
+    Codec codec;
+    unsigned int value;
+    int pos = 0, printed = 0, n;
+
+    memset(&codec, 0, sizeof(codec));
+    while (pos < len && page[pos] != 0xFF && !(page[pos] & 0x80)) {
+        unsigned char header = page[pos++];
+        unsigned short *prev = codec.prev[header & HDR_SENSOR];
+        unsigned int time;
+
+        if (codec.count == 0 || !(header & HDR_SAME_DT)) {
+            if (!(n = GetVarint(page + pos, len - pos, &value)))
+                break;
+            pos += n;
+            if (codec.count == 0) {
+                time = value;
+            } else {
+                time = codec.time + value;
+                codec.dt = value;
+            }
+        } else {
+            time = codec.time + codec.dt;
+        }
+
+        if (header & HDR_NIBBLES) {
+            if (len - pos < 2)
+                break;
+            for (int i = 0; i < 4; i++) {
+                int delta = (page[pos + i / 2] >> (4 * (i & 1))) & 0x0F;
+                prev[i] += delta >= 8 ? delta - 16 : delta;
+            }
+            pos += 2;
+        } else {
+            int i;
+            for (i = 0; i < 4; i++) {
+                if (!(n = GetVarint(page + pos, len - pos, &value)))
+                    break;
+                pos += n;
+                prev[i] += (int) (value >> 1) ^ -(int) (value & 1);
+            }
+            if (i < 4)
+                break;
+        }
+
+        codec.time = time;
+        codec.count++;
+        if (time >= from && time <= to) {
+            printf("%u,%d,%d,%d,%u,%u,%u,%u\n", time, header & HDR_SENSOR, (header & HDR_SATURATED) ? 1 : 0,
+                    (header & HDR_RED) ? 1 : 0, prev[0], prev[1], prev[2], prev[3]);
+            printed++;
+        }
+    }
+    if (pos < len && page[pos] != 0xFF)
+        fprintf(stderr, "pagina corrotta al byte %d\n", pos);
+    return printed;
+}
+
+int main(int argc, char **argv) {
+    unsigned int from = argc > 1 ? strtoul(argv[1], 0, 10) : 0;
+    unsigned int to = argc > 2 ? strtoul(argv[2], 0, 10) : 0xFFFFFFFF;
+    unsigned char frame[1 + PAGE_DATA + 2];
+    int c, prev = -1, pages = 0, records = 0, errors = 0;
+
+    printf("time,sensor,saturated,red,c,r,g,b\n");
+    while ((c = getchar()) != EOF) {
+        if (prev != SYNC1 || c != SYNC2) { // Skip the text before the dump and after a bad frame
+            prev = c;
+            continue;
+        }
+        prev = -1;
+
+        if ((c = getchar()) == EOF)
+            break;
+        frame[0] = c;
+        if (fread(frame + 1, 1, frame[0] + 2, stdin) != (size_t) frame[0] + 2)
+            break;
+
+        unsigned short crc = frame[1 + frame[0]] | (frame[2 + frame[0]] << 8);
+        if (CRC16(0xFFFF, frame, 1 + frame[0]) != crc) {
+            errors++;
+            continue;
+        }
+        if (frame[0] == 0)
+            break; // End of the dump
+        records += DecodePage(frame + 1, frame[0], from, to);
+        pages++;
+    }
+
+    fprintf(stderr, "%d pagine, %d campioni, %d frame errati\n", pages, records, errors);
+    return errors ? 1 : 0;
+}
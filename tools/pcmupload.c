@@ -0,0 +1,58 @@
+/*
+ * File:   pcmupload.c
+ * @brief Host sender for the PCM clip played by function 13.
+ *
+ * This program reads 8 bit unsigned mono samples from stdin and writes to stdout the terminal commands
+ * that store them in SPI flash: "pcm rate length", then the samples as hex lines of LINE bytes.
+ * It waits for the sector erase after the command and after each line for the page program,
+ * so stdout can be the serial port itself.
+ *
+ *      gcc -o pcmupload tools/pcmupload.c
+ *      stty -F /dev/ttyUSB0 9600 raw
+ *      pcmupload rate < clip.raw > /dev/ttyUSB0
+ *
+ * @date October 19, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define LINE 32 // AUDIO_PCM_UPLOAD_LINE
+#define MAX_LENGTH (0x10000 - 0x7000 - 8) // SPIFLASH_LOG_ADDR - SPIFLASH_PCM_ADDR - header
+#define MIN_RATE 1221 // AUDIO_PCM_MIN_RATE
+#define MAX_RATE 22050 // AUDIO_PCM_MAX_RATE
+#define SECTOR_SIZE 4096
+#define ERASE_MS 400 // maximum sector erase time
+#define LINE_MS 10 // page program and verify of one line
+
+int main(int argc, char **argv) {
+    static unsigned char samples[MAX_LENGTH + 1];
+    unsigned int rate = argc > 1 ? strtoul(argv[1], 0, 10) : 0;
+
+    if (rate < MIN_RATE || rate > MAX_RATE) {
+        fprintf(stderr, "uso: pcmupload frequenza (%d..%d) < clip.raw > porta\n", MIN_RATE, MAX_RATE);
+        return 1;
+    }
+
+    size_t length = fread(samples, 1, sizeof(samples), stdin);
+    if (length == 0 || length > MAX_LENGTH) {
+        fprintf(stderr, "La clip deve avere da 1 a %d campioni\n", MAX_LENGTH);
+        return 1;
+    }
+
+    printf("pcm %u %u\n", rate, (unsigned int) length);
+    fflush(stdout);
+    usleep(((8 + length) / SECTOR_SIZE + 1) * ERASE_MS * 1000);
+
+    for (size_t i = 0; i < length; i += LINE) {
+        for (size_t j = i; j < i + LINE && j < length; j++)
+            printf("%02X", samples[j]);
+        printf("\n");
+        fflush(stdout);
+        usleep(LINE_MS * 1000);
+    }
+
+    fprintf(stderr, "%u campioni inviati a %u Hz\n", (unsigned int) length, rate);
+    return 0;
+}
@@ -1,4 +1,6 @@
+#include "clock.h"
 #include "config.h"
+#include "timer.h"
 #include "uart.h"
 #include <p32xxxx.h>
 
@@ -8,6 +10,8 @@
 extern unsigned char uartFlag;
 extern unsigned int uartCount;
 
+unsigned int uartBaud = 9600; // baud rate, kept across clock changes
+
 /***	UART_Init
 **
 **	Parameters:
@@ -60,11 +64,15 @@ void UART_ConfigurePins() {
 **
 **	Description:
 **		This function configures the UART module with the specified baud rate.
-**      It sets various UART mode and status bits, and calculates the baud rate generator value.
+**      It sets various UART mode and status bits, and calculates the baud rate generator value
+**      for the current peripheral bus clock.
 **      
 **          
 */
 void UART_ConfigureUart(unsigned int baud) {
+    int brgh;
+    
+    uartBaud = baud;
     U4MODEbits.ON = 0; // Turn off uart before config
     U4MODEbits.SIDL = 0;
     U4MODEbits.IREN = 0;
@@ -79,15 +87,100 @@ void UART_ConfigureUart(unsigned int baud) {
     U4MODEbits.PDSEL0 = 0;
     U4MODEbits.STSEL = 0;
     
-    U4MODEbits.BRGH = 0;
-    
     /* calculate brg */
-    U4BRG = (int) (((float) PB_CLK / (16 * baud) - 1) + 0.5); // add 0.5 to round
+    U4BRG = UART_GetBRG(CLOCK_GetPB(), baud, &brgh);
+    U4MODEbits.BRGH = brgh;
     
     U4STAbits.UTXEN = 1;
     U4STAbits.URXEN = 1;
 }
 
+/***	UART_GetBRG
+**
+**	Parameters:
+**      unsigned int pb - Peripheral bus clock (Hz).
+**      unsigned int baud - The baud rate for UART communication.
+**      int *brgh - Returns the BRGH bit to be used.
+**
+**	Return Value:
+**      unsigned int - Baud rate generator value, rounded to the nearest.
+**
+**	Description:
+**		This function computes the baud rate generator. The standard 16x clock is used unless the
+**      divisor gets too coarse (slow clock profile), then the 4x clock keeps the error low.
+**      
+**          
+*/
+unsigned int UART_GetBRG(unsigned int pb, unsigned int baud, int *brgh) {
+    *brgh = pb / (16 * baud) < UART_MIN_DIVISOR;
+    unsigned int div = (*brgh ? 4 : 16) * baud;
+    
+    return (pb + div / 2) / div - 1; // add div / 2 to round
+}
+
+/***	UART_BaudError
+**
+**	Parameters:
+**      unsigned int pb - Peripheral bus clock (Hz).
+**
+**	Return Value:
+**      unsigned int - Baud rate error in per mille.
+**
+**	Description:
+**		This function returns the error of the current baud rate if the UART ran at the given clock,
+**      so a clock profile that would break the serial link can be refused.
+**      
+**          
+*/
+unsigned int UART_BaudError(unsigned int pb) {
+    int brgh;
+    unsigned int brg = UART_GetBRG(pb, uartBaud, &brgh);
+    unsigned int real = pb / ((brgh ? 4 : 16) * (brg + 1));
+    
+    return (real > uartBaud ? real - uartBaud : uartBaud - real) * 1000 / uartBaud;
+}
+
+/***	UART_ClockChanged
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function recomputes the baud rate generator after a peripheral bus clock change.
+**      Called by CLOCK_SetProfile after UART_Flush, the module stays on.
+**      
+**          
+*/
+void UART_ClockChanged() {
+    int brgh;
+    
+    U4BRG = UART_GetBRG(CLOCK_GetPB(), uartBaud, &brgh);
+    U4MODEbits.BRGH = brgh;
+}
+
+/***	UART_Flush
+**
+**	Parameters:
+**
+**	Return Value:
+**
+**	Description:
+**		This function waits until the last character has been shifted out and the receiver is idle,
+**      so that a clock change does not cut a character in either direction. The wait for the
+**      receiver lasts at most one frame (10 bits): a character still arriving after that
+**      (continuous stream or break on the line) is sampled with the new divisor and lost.
+**      
+**          
+*/
+void UART_Flush() {
+    unsigned int start = TIMER_GetCoreTicks();
+    unsigned int frame = CORE_TICKS_PER_US * (10000000 / uartBaud + 1);
+    
+    while (!U4STAbits.TRMT);
+    while (!U4STAbits.RIDLE && TIMER_GetCoreTicks() - start < frame);
+}
+
 /***	UART_ConfigureUartRXInt
 **
 **	Parameters:
@@ -16,17 +16,23 @@
 
 #define avl_UART4_RX U4STAbits.URXDA // RX availability
 
+#define UART_MIN_DIVISOR 16 // below this 16x divisor the 4x clock (BRGH) is used
+
 /* public function */
 void UART_Init(unsigned int baud);
 void UART_PutChar(char c);
 char UART_GetChar();
 void UART_PutString(char szData[]);
 unsigned char UART_GetString(char *pText);
+unsigned int UART_BaudError(unsigned int pb);
+void UART_ClockChanged();
+void UART_Flush();
 
 /* private function */
 void UART_ConfigurePins();
 void UART_ConfigureUart(unsigned int baud);
 void UART_ConfigureUartRXInt(unsigned int baud);
+unsigned int UART_GetBRG(unsigned int pb, unsigned int baud, int *brgh);
 
 #endif	/* UART_H */
 